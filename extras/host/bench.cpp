@@ -0,0 +1,550 @@
+/*
+Widget benchmark for phi_prompt on the host simulator.
+Each scenario initializes a 20x4 serial LCD, drives one widget with scripted keys and reports per key press:
+bytes sent to the display, display commands, time spent in delay(), time the bytes take on a 9600 baud link, time the CPU waited on the link and host CPU time.
+The Serial1 scenario drives the display from a buffered hardware serial port switched to 38400 baud instead, so the CPU only waits when its transmit buffer is full.
+Frame scenarios redraw a display such as gauges a number of times without keys and report the same per frame.
+The formatter runs are timed against the sprintf calls the library used before and must give the same characters.
+Values too wide for their field are counted apart: sprintf printed every digit past the field, where the library fills the field with # instead.
+Scenarios with a check also compare the value the widget returns and the final screen with what the keys should give. The benchmark exits with 1 if any of them or the formatter differ.
+The front and rear scenario runs a second user interface on a 16x2 display with its own keypad, polled round robin with the first. Its bytes count too.
+Run with -v to see the screen and the library's own counters after each scenario.
+*/
+#include <time.h>
+#include "sim.h"
+#include <phi_prompt.h>
+
+SoftwareSerial lcd;
+sim_uart uart;
+sim_keypad keypad;
+multiple_button_input *keypads[]={&keypad,0};
+char up_keys[]="U", down_keys[]="D", left_keys[]="L", right_keys[]="R", enter_keys[]="E", escape_keys[]="X";
+char *function_keys[]={up_keys,down_keys,left_keys,right_keys,enter_keys,escape_keys};
+
+const char item00[] PROGMEM="Set point";
+const char item01[] PROGMEM="Proportional gain";
+const char item02[] PROGMEM="Integral time";
+const char item03[] PROGMEM="Derivative time";
+const char item04[] PROGMEM="Output limits and ramp rate for the heater";
+const char item05[] PROGMEM="Alarm high";
+const char item06[] PROGMEM="Alarm low";
+const char item07[] PROGMEM="Sensor offset";
+const char item08[] PROGMEM="Units";
+const char item09[] PROGMEM="Log interval";
+const char item10[] PROGMEM="Backlight";
+const char item11[] PROGMEM="Contrast";
+const char item12[] PROGMEM="Date and time";
+const char item13[] PROGMEM="Network";
+const char item14[] PROGMEM="Factory reset";
+const char item15[] PROGMEM="About";
+const char* const menu_items[] PROGMEM={item00,item01,item02,item03,item04,item05,item06,item07,item08,item09,item10,item11,item12,item13,item14,item15};
+const phi_prompt_list_item menu_descriptors[] PROGMEM={phi_prompt_item(item00),phi_prompt_item(item01),phi_prompt_item(item02),phi_prompt_item(item03),phi_prompt_item(item04),phi_prompt_item(item05),phi_prompt_item(item06),phi_prompt_item(item07),
+  phi_prompt_item(item08),phi_prompt_item(item09),phi_prompt_item(item10),phi_prompt_item(item11),phi_prompt_item(item12),phi_prompt_item(item13),phi_prompt_item(item14),phi_prompt_item(item15)};
+
+const char help_text[] PROGMEM="Setup menu help\nUse up and down to move one line and left and right to move one page. The controller keeps running while you read this.\n\nSet point is the temperature the heater holds. Gains tune how fast it gets there.\nAlarms trip the relay output when the reading leaves the band for longer than the alarm delay.\n\nPress enter or escape to leave.";
+
+static boolean verbose;
+static phi_prompt_struct para;
+static int integer_value;
+static long flow_preset, batch_size;
+static float temperature_setpoint;
+static char panel_buffer[]="SENSOR 01   ";
+
+static void setup_list(int option)
+{
+  para.ptr.list=(char**)menu_items;
+  para.low.i=0;
+  para.high.i=15;
+  para.width=16;
+  para.col=0;
+  para.row=0;
+  para.step.c_arr[0]=4; // rows
+  para.step.c_arr[1]=1; // columns
+  para.step.c_arr[2]=3; // index row
+  para.step.c_arr[3]=17; // index column
+  para.option=option;
+}
+
+static int run_list()
+{
+  setup_list(phi_prompt_arrow_dot|phi_prompt_scroll_bar);
+  return select_list(&para);
+}
+
+static int run_list_scroll()
+{
+  setup_list(phi_prompt_arrow_dot|phi_prompt_auto_scroll|phi_prompt_center_choice);
+  return select_list(&para);
+}
+
+static int run_list_descriptors()
+{
+  setup_list(phi_prompt_arrow_dot|phi_prompt_auto_scroll|phi_prompt_center_choice|phi_prompt_list_items);
+  para.ptr.items=menu_descriptors;
+  return select_list(&para);
+}
+
+static int log_fetch(long item, int offset, char *dst, byte len) // Pretends to read entry item of a data log on SD.
+{
+  char entry[64]; // Room for any long item number and the longer message.
+  int entry_len=snprintf(entry,sizeof(entry),"%05ld %s",item,(item%7)?"temperature 21.5C":"heater output limited by ramp rate");
+  for (byte i=0;(i<len)&&(offset+i<entry_len);i++) dst[i]=entry[offset+i];
+  return entry_len;
+}
+
+static int run_list_callback()
+{
+  static char cache[4*16];
+  static int lengths[4];
+  static phi_prompt_list_source source={log_fetch,cache,lengths,-1,0};
+  setup_list(phi_prompt_arrow_dot|phi_prompt_auto_scroll|phi_prompt_scroll_bar|phi_prompt_list_callback);
+  para.ptr.source=&source;
+  para.low.l=4990;
+  para.high.l=9999;
+  return select_list(&para);
+}
+
+static int run_text_area()
+{
+  para.ptr.msg_P=help_text;
+  para.low.i=0;
+  para.step.c_arr[0]=4; // rows
+  para.step.c_arr[1]=19; // columns
+  para.col=0;
+  para.row=0;
+  para.option=1;
+  return text_area_P(&para);
+}
+
+static int run_text_area_indexed()
+{
+  static int line_starts[64];
+  set_line_index(line_starts,64);
+  int ret=run_text_area();
+  set_line_index(0,0);
+  return ret;
+}
+
+static void setup_integer()
+{
+  integer_value=100;
+  para.ptr.i_buffer=&integer_value;
+  para.low.i=0;
+  para.high.i=1000;
+  para.step.i=5;
+  para.width=4;
+  para.col=8;
+  para.row=1;
+  para.option=1;
+}
+
+static int run_integer()
+{
+  setup_integer();
+  return input_integer(&para);
+}
+
+static int run_integer_held() // Up held for 9 seconds on a 0-30000 setpoint.
+{
+  setup_integer();
+  integer_value=0;
+  para.high.i=30000;
+  para.step.i=1;
+  para.width=5;
+  keypad.holding=true; // The keypad reports the repeats of the held key.
+  int ret=input_integer(&para);
+  keypad.holding=false;
+  return ret;
+}
+
+static int run_long() // A flow totalizer preset in litres, beyond what an int holds.
+{
+  flow_preset=1995000;
+  para.ptr.l_buffer=&flow_preset;
+  para.low.l=0;
+  para.high.l=2000000;
+  para.step.l=1000;
+  para.width=8;
+  para.col=6;
+  para.row=1;
+  para.option=2;
+  return input_long(&para);
+}
+
+static int run_float() // A temperature setpoint of 21.5 moved to -18.25, one digit at a time.
+{
+  temperature_setpoint=21.5;
+  para.ptr.f_buffer=&temperature_setpoint;
+  para.step.c_arr[1]=3;
+  para.step.c_arr[0]=2;
+  para.col=6;
+  para.row=1;
+  para.option=2;
+  return input_float(&para);
+}
+
+static int run_fixed() // A batch size of 250 with no decimals typed to 951, leaving past the last digit.
+{
+  batch_size=250;
+  para.ptr.l_buffer=&batch_size;
+  para.step.c_arr[1]=4;
+  para.step.c_arr[0]=0;
+  para.col=6;
+  para.row=1;
+  para.option=0;
+  return input_fixed(&para);
+}
+
+static int run_panel()
+{
+  strcpy(panel_buffer,"SENSOR 01   ");
+  para.ptr.msg=panel_buffer;
+  para.low.c=' ';
+  para.high.c='Z';
+  para.width=12;
+  para.col=2;
+  para.row=2;
+  para.option=1;
+  return input_panel(&para);
+}
+
+static int run_panel_multi_tap() // Types PUMP 2 over the label on a phone keypad.
+{
+  enable_multi_tap(1);
+  int ret=run_panel();
+  enable_multi_tap(0);
+  return ret;
+}
+
+static int run_panel_carry() // Steps the number in FILE0098 up past 0100 and back.
+{
+  strcpy(panel_buffer,"FILE0098    ");
+  para.ptr.msg=panel_buffer;
+  para.low.c='0';
+  para.high.c='9';
+  para.width=12;
+  para.col=2;
+  para.row=2;
+  para.option=4;
+  return input_panel(&para);
+}
+
+static SoftwareSerial rear_lcd;
+static sim_lcd rear_screen;
+static sim_keypad rear_keypad;
+static multiple_button_input *rear_keypads[]={&rear_keypad,0};
+static phi_prompt_context rear;
+
+static int run_front_and_rear() // The operator steps the set point on the front display while a technician scrolls the service menu on the rear one.
+{
+  static phi_prompt_struct rear_para;
+  phi_prompt_task front_task, rear_task;
+  phi_prompt_task *tasks[]={&front_task,&rear_task};
+  rear_screen.begin(16,2);
+  rear_lcd.screen=&rear_screen;
+  phi_prompt_bind(&rear);
+  init_phi_prompt(&rear_lcd,rear_keypads,function_keys,16,2,'~');
+  clear();
+  rear_para.ptr.list=(char**)menu_items;
+  rear_para.low.i=0;
+  rear_para.high.i=15;
+  rear_para.width=15;
+  rear_para.col=0;
+  rear_para.row=0;
+  rear_para.step.c_arr[0]=2; // rows
+  rear_para.step.c_arr[1]=1; // columns
+  rear_para.option=phi_prompt_arrow_dot;
+  select_list_begin(&rear_task,&rear_para);
+  phi_prompt_bind(0);
+  rear_keypad.script("DDDDDDDDUE",230);
+  setup_integer();
+  input_integer_begin(&front_task,&para);
+  while (phi_prompt_poll_all(tasks,2)) {}
+  if (verbose) rear_screen.dump(stdout);
+  return phi_prompt_result(&front_task);
+}
+
+static int run_integer_uart()
+{
+  init_phi_prompt_hardware_serial(&uart,keypads,function_keys,20,4,'~',38400);
+  clear();
+  setup_integer();
+  int ret=input_integer(&para);
+  uart.begin(9600); // Where the backpack was before, for the next run.
+  return ret;
+}
+
+static boolean screen_shows(byte col, byte row, const char *text) // Whether the display shows text from col on row.
+{
+  for (byte i=0;text[i];i++) if (sim_screen.cell(col+i,row)!=text[i]) return false;
+  return true;
+}
+
+static boolean check_integer(int result)
+{
+  return (result==1)&&(integer_value==125)&&screen_shows(8,1,"0125");
+}
+
+static boolean check_integer_held(int result)
+{
+  return (result==1)&&(integer_value==4110)&&screen_shows(8,1,"04110");
+}
+
+static boolean check_long(int result) // Five ups reach the limit, the sixth wraps to 0 and the downs wrap back.
+{
+  return (result==1)&&(flow_preset==2000000)&&screen_shows(6,1," 2000000");
+}
+
+static boolean check_float(int result)
+{
+  return (result==1)&&(temperature_setpoint>-18.2501)&&(temperature_setpoint<-18.2499)&&screen_shows(6,1,"-18.25 ");
+}
+
+static boolean check_fixed(int result) // Right on the last digit leaves with -4 and keeps the digits, and there is no decimal point.
+{
+  return (result==-4)&&(batch_size==951)&&screen_shows(6,1,"0951 ");
+}
+
+static boolean check_multi_tap(int result)
+{
+  return (result==1)&&!strcmp(panel_buffer,"PUMP 2 01   ")&&screen_shows(2,2,"PUMP 2 01   ");
+}
+
+static boolean check_carry(int result) // Up on the last digit carries into the ones before it.
+{
+  return (result==1)&&!strcmp(panel_buffer,"FILE0099    ")&&screen_shows(2,2,"FILE0099    ");
+}
+
+struct scenario
+{
+  const char *name;
+  const char *keys;
+  int (*run)();
+  boolean (*check)(int result); // Whether the widget left the right value and screen, or 0 to only measure.
+};
+
+static const scenario scenarios[]=
+{
+  {"select_list", "DDDDDDDUUURRLE", run_list},
+  {"select_list auto scroll", "DDDDDDDDDDE", run_list_scroll},
+  {"select_list descriptors", "DDDDDDDDDDE", run_list_descriptors},
+  {"select_list callback", "DDDDDDDDDDUUE", run_list_callback},
+  {"text_area_P", "DDDDRRUULLE", run_text_area},
+  {"text_area_P line index", "DDDDRRUULLE", run_text_area_indexed},
+  {"input_integer", "UUUUUUUUUUDDDDDE", run_integer, check_integer},
+  {"input_integer held", "UUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUUE", run_integer_held, check_integer_held},
+  {"input_long", "UUUUUUUDDE", run_long, check_long},
+  {"input_float", "URDR825E", run_float, check_float},
+  {"input_fixed no decimals", "R9RUR", run_fixed, check_fixed},
+  {"input_panel", "UUURUUURRDDRLLE", run_panel},
+  {"input_panel multi-tap", "7886702222E", run_panel_multi_tap, check_multi_tap},
+  {"input_panel carry", "RRRRRRRUUUDDE", run_panel_carry, check_carry},
+  {"input_integer Serial1", "UUUUUUUUUUDDDDDE", run_integer_uart, check_integer},
+  {"front and rear", "UUUUUUUUUUDDDDDE", run_front_and_rear, check_integer}, // Last, so the rear keypad is not scanned by the other scenarios.
+};
+
+static void draw_gauges(int frame) // Three tank levels sampled at 10 Hz, changing at different rates.
+{
+  bar_gauge_h(500+frame*3,0,1000,0,1,16);
+  bar_gauge_h(900-frame*7,0,1000,0,2,16);
+  bar_gauge_h(frame%20<10?245:255,0,1000,0,3,16);
+}
+
+static int tank_temp, motor_rpm, setpoint=215;
+static long run_seconds, flow_ml;
+static phi_prompt_field dashboard_fields[]=
+{
+  {&tank_temp,phi_prompt_field_int,5,0,5,1,2},
+  {&setpoint,phi_prompt_field_int,15,0,5,1,2},
+  {&motor_rpm,phi_prompt_field_int,5,1,4,0,2},
+  {&run_seconds,phi_prompt_field_long,14,1,6,0,2},
+  {&flow_ml,phi_prompt_field_long,5,2,10,3,2},
+};
+static phi_prompt_dashboard dashboard={dashboard_fields,5,24,0};
+
+static void draw_dashboard(int frame) // A status screen at 10 Hz. Temperature and flow change every frame, the rest less often.
+{
+  if (frame==0)
+  {
+    setCursor(0,0);
+    phi_prompt_print("Temp       Set");
+    setCursor(0,1);
+    phi_prompt_print("RPM       Run");
+    setCursor(0,2);
+    phi_prompt_print("Flow            L");
+    phi_prompt_dashboard_invalidate(&dashboard);
+  }
+  tank_temp=200+frame%7;
+  motor_rpm=1450+(frame/10)%3;
+  run_seconds=3600+frame/10;
+  flow_ml+=137;
+  phi_prompt_dashboard_update(&dashboard);
+}
+
+struct frame_scenario
+{
+  const char *name;
+  int frames;
+  void (*draw)(int frame);
+};
+
+static const frame_scenario frame_scenarios[]=
+{
+  {"bar_gauge_h x3", 100, draw_gauges},
+  {"dashboard 5 fields", 100, draw_dashboard},
+};
+
+static const int format_room=256; // Room for sprintf with any byte width. The old code printed every digit, whatever the field width.
+
+static void sprintf_number(char *msg, long value, byte width, byte decimals, byte option) // The sprintf calls the library made before phi_prompt_format_number().
+{
+  if (decimals) // Fixed point went through a float, as input_float did.
+  {
+    double scale=1;
+    for (byte i=0;i<decimals;i++) scale*=10;
+    if (option==0) snprintf(msg,format_room,"%-*.*f",(int)width,(int)decimals,value/scale);
+    else snprintf(msg,format_room,(option==1)?"%0*.*f":"%*.*f",(int)width,(int)decimals,value/scale);
+  }
+  else if (option==0) snprintf(msg,format_room,"%-*ld",(int)width,value); // "%d" over a field blanked first.
+  else if (option==1) snprintf(msg,format_room,"%0*ld",(int)width,value); // The patched "%0Nd" format.
+  else snprintf(msg,format_room,"%*ld",(int)width,value); // Documented as space pad left but never drawn before.
+}
+
+static void format_with_sprintf(char *msg, long value, byte width, byte decimals, byte option)
+{
+  if (decimals==255) snprintf(msg,format_room,"%ld/%ld",value,value+width); // Stands for the list index.
+  else sprintf_number(msg,value,width,decimals,option);
+}
+
+static void format_with_library(char *msg, long value, byte width, byte decimals, byte option)
+{
+  if (decimals==255) phi_prompt_format_index(msg,value,value+width);
+  else phi_prompt_format_number(msg,value,width,decimals,option);
+}
+
+struct format_case
+{
+  const char *name;
+  byte width;
+  byte decimals;
+  byte option;
+};
+
+static const format_case format_cases[]=
+{
+  {"number pad right", 6, 0, 0},
+  {"number zero fill", 6, 0, 1},
+  {"number pad left", 6, 0, 2},
+  {"fixed 2 decimals", 8, 2, 1},
+  {"fixed 3 decimals", 7, 3, 2},
+  {"index n/m", 16, 255, 0},
+};
+
+static long format_value(long i) // Small and large values of both signs, some too wide for the field.
+{
+  long v=(i*7919L)%200000L-100000L;
+  return (i%5==0)?v*1000L:v;
+}
+
+static double cpu_seconds()
+{
+  timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+  verbose=(argc>1)&&(strcmp(argv[1],"-v")==0);
+  int failures=0;
+  printf("%-26s %8s %8s %8s %10s %10s %10s %10s\n", "scenario", "keys", "bytes/k", "cmds/k", "delay ms/k", "wire ms/k", "wait ms/k", "cpu us/k");
+  for (unsigned s=0;s<sizeof(scenarios)/sizeof(scenarios[0]);s++)
+  {
+    sim_screen.begin(20,4);
+    init_phi_prompt(&lcd,keypads,function_keys,20,4,'~');
+    clear();
+    while (phi_prompt_service());
+    sim_reset_counters();
+    phi_prompt_reset_stats();
+    keypad.script(scenarios[s].keys,150);
+    double start=cpu_seconds();
+    int result=scenarios[s].run();
+    while (phi_prompt_service());
+    uart.flush();
+    double cpu=cpu_seconds()-start;
+    double keys=strlen(scenarios[s].keys);
+    printf("%-26s %8d %8.1f %8.1f %10.1f %10.1f %10.1f %10.1f\n", scenarios[s].name, (int)keys, sim_count.bytes/keys, sim_count.commands/keys, sim_count.delay_ms/keys, sim_count.wire_us/keys/1000.0, sim_count.blocked_us/keys/1000.0, cpu*1e6/keys);
+    if (scenarios[s].check&&!scenarios[s].check(result))
+    {
+      printf("  FAILED: returned %d and left a different value or screen\n",result);
+      failures++;
+    }
+    if (verbose)
+    {
+      sim_screen.dump(stdout);
+      phi_prompt_dump_stats(&Serial);
+    }
+  }
+  printf("\n%-26s %8s %8s %8s %10s %10s %10s %10s\n", "scenario", "frames", "bytes/f", "cmds/f", "delay ms/f", "wire ms/f", "wait ms/f", "cpu us/f");
+  for (unsigned s=0;s<sizeof(frame_scenarios)/sizeof(frame_scenarios[0]);s++)
+  {
+    sim_screen.begin(20,4);
+    init_phi_prompt(&lcd,keypads,function_keys,20,4,'~');
+    clear();
+    frame_scenarios[s].draw(0); // The first frame draws every cell, so leave it out.
+    while (phi_prompt_service());
+    sim_reset_counters();
+    double start=cpu_seconds();
+    for (int f=1;f<=frame_scenarios[s].frames;f++)
+    {
+      frame_scenarios[s].draw(f);
+      while (phi_prompt_service());
+    }
+    double cpu=cpu_seconds()-start;
+    double frames=frame_scenarios[s].frames;
+    printf("%-26s %8d %8.1f %8.1f %10.1f %10.1f %10.1f %10.1f\n", frame_scenarios[s].name, (int)frames, sim_count.bytes/frames, sim_count.commands/frames, sim_count.delay_ms/frames, sim_count.wire_us/frames/1000.0, sim_count.blocked_us/frames/1000.0, cpu*1e6/frames);
+    if (verbose) sim_screen.dump(stdout);
+  }
+  const long calls=100000;
+  printf("\n%-26s %8s %10s %8s %12s %12s\n", "formatter", "calls", "mismatches", "wider", "sprintf ns", "library ns");
+  for (unsigned s=0;s<sizeof(format_cases)/sizeof(format_cases[0]);s++)
+  {
+    const format_case &c=format_cases[s];
+    char expected[format_room], actual[format_room];
+    long mismatches=0, wider=0;
+    volatile char sink=0; // Keeps the timed loops from being optimized away.
+    for (long i=0;i<calls;i++)
+    {
+      format_with_sprintf(expected,format_value(i),c.width,c.decimals,c.option);
+      format_with_library(actual,format_value(i),c.width,c.decimals,c.option);
+      if ((c.decimals!=255)&&(strlen(expected)>c.width)) // sprintf ran past the field. The library shows # instead, on purpose.
+      {
+        wider++;
+        if (strspn(actual,"#")==c.width) continue;
+      }
+      if (strcmp(expected,actual))
+      {
+        if (verbose&&(mismatches<5)) printf("  %ld: \"%s\" instead of \"%s\"\n",format_value(i),actual,expected);
+        mismatches++;
+      }
+    }
+    double start=cpu_seconds();
+    for (long i=0;i<calls;i++)
+    {
+      format_with_sprintf(expected,format_value(i),c.width,c.decimals,c.option);
+      sink+=expected[0];
+    }
+    double with_sprintf=cpu_seconds()-start;
+    start=cpu_seconds();
+    for (long i=0;i<calls;i++)
+    {
+      format_with_library(actual,format_value(i),c.width,c.decimals,c.option);
+      sink+=actual[0];
+    }
+    double with_library=cpu_seconds()-start;
+    printf("%-26s %8ld %10ld %8ld %12.1f %12.1f\n", c.name, calls, mismatches, wider, with_sprintf*1e9/calls, with_library*1e9/calls);
+    if (mismatches) failures++;
+  }
+  if (failures) printf("\n%d check(s) failed\n",failures);
+  return failures?1:0;
+}
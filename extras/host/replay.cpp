@@ -0,0 +1,367 @@
+/*
+Trace replay for phi_prompt on the host simulator.
+A trace is what phi_prompt_record() writes: every byte the library sent to the display and every key it took, with times.
+This plays the keys of each trace back through the library in the millisecond they were taken, starting at the time the recording did and in the order the traces were recorded, records the display output again and compares it with the trace:
+the screen before each key and at the end must be the same, while the bytes and commands it took to get there are reported so rendering changes show their savings.
+
+  replay golden/NAME.trace    compares the library with the traces and fails if a screen differs.
+  replay --record golden      records the sessions below with their scripted keys as new golden traces.
+
+A trace names the session that made it. Sessions captured on a device need the same menu code added to the session table to be replayed.
+*/
+#include <algorithm>
+#include <vector>
+#include <string>
+#include "sim.h"
+#include <phi_prompt.h>
+
+SoftwareSerial lcd;
+
+class trace_keypad : public multiple_button_input ///< Returns each key of a trace once the millisecond it was taken has come, so the library sees the same millis() when it takes it.
+{
+  public:
+  virtual byte getKey()
+  {
+    sim_advance_us(100); // Polling a keypad takes time like sim_keypad.
+    if (next>=keys.size()) return NO_KEY;
+    if (millis()<(start+times[next])/1000) return NO_KEY;
+    return keys[next++];
+  }
+  std::vector<byte> keys;
+  std::vector<unsigned long> times; // Microseconds after recording started.
+  unsigned long start;
+  size_t next;
+};
+
+class buffer_print : public Print ///< Collects what is printed to it, such as a trace.
+{
+  public:
+  virtual size_t write(uint8_t b) { data.push_back(b); return 1; }
+  using Print::write;
+  std::vector<byte> data;
+};
+
+static trace_keypad replay_keypad;
+static sim_keypad script_keypad;
+static multiple_button_input *replay_keypads[]={&replay_keypad,0};
+static multiple_button_input *script_keypads[]={&script_keypad,0};
+char up_keys[]="U", down_keys[]="D", left_keys[]="L", right_keys[]="R", enter_keys[]="E", escape_keys[]="X";
+char *function_keys[]={up_keys,down_keys,left_keys,right_keys,enter_keys,escape_keys};
+
+const char item00[] PROGMEM="Set point";
+const char item01[] PROGMEM="Proportional gain";
+const char item02[] PROGMEM="Integral time";
+const char item03[] PROGMEM="Output limits and ramp rate for the heater";
+const char item04[] PROGMEM="Alarm high";
+const char item05[] PROGMEM="Alarm low";
+const char item06[] PROGMEM="Sensor offset";
+const char item07[] PROGMEM="Units";
+const char item08[] PROGMEM="Log interval";
+const char item09[] PROGMEM="About";
+const char* const menu_items[] PROGMEM={item00,item01,item02,item03,item04,item05,item06,item07,item08,item09};
+const char set_point_label[] PROGMEM="Set point";
+const char offset_label[] PROGMEM="Offset";
+const char help_text[] PROGMEM="Alarms\nThe relay trips when the reading leaves the band between alarm low and alarm high for longer than the alarm delay.\nIt resets once the reading is back inside the band by the hysteresis.";
+
+static phi_prompt_struct para;
+static const unsigned long session_spacing=60000000UL; // Microseconds between the starts of recorded sessions.
+
+static void session_menu() // Scrolls the setup menu with a scroll bar and auto scrolling.
+{
+  para.ptr.list=(char**)menu_items;
+  para.low.i=0;
+  para.high.i=9;
+  para.width=16;
+  para.col=0;
+  para.row=0;
+  para.step.c_arr[0]=4; // rows
+  para.step.c_arr[1]=1; // columns
+  para.option=phi_prompt_arrow_dot|phi_prompt_scroll_bar|phi_prompt_auto_scroll;
+  select_list(&para);
+}
+
+static void session_set_point() // Steps an integer set point and then a float offset.
+{
+  static int set_point;
+  static float offset;
+  set_point=215;
+  offset=-1.5;
+  msg_lcd((char*)set_point_label);
+  para.ptr.i_buffer=&set_point;
+  para.low.i=0;
+  para.high.i=400;
+  para.step.i=5;
+  para.width=4;
+  para.col=12;
+  para.row=0;
+  para.option=2;
+  input_integer(&para);
+  setCursor(0,1);
+  msg_lcd((char*)offset_label);
+  para.ptr.f_buffer=&offset;
+  para.step.c_arr[1]=2;
+  para.step.c_arr[0]=1;
+  para.col=12;
+  para.row=1;
+  para.option=2;
+  input_float(&para);
+}
+
+static void session_help() // Pages through a help text.
+{
+  para.ptr.msg_P=help_text;
+  para.low.i=0;
+  para.step.c_arr[0]=4; // rows
+  para.step.c_arr[1]=19; // columns
+  para.col=0;
+  para.row=0;
+  para.option=1;
+  text_area_P(&para);
+}
+
+static void session_label() // Edits a sensor label.
+{
+  static char label[]="TANK 1      ";
+  strcpy(label,"TANK 1      ");
+  para.ptr.msg=label;
+  para.low.c=' ';
+  para.high.c='Z';
+  para.width=12;
+  para.col=4;
+  para.row=2;
+  para.option=1;
+  input_panel(&para);
+}
+
+struct session
+{
+  const char *name;
+  const char *keys;         // Keys recorded in the golden trace.
+  void (*run)();
+};
+
+static const session sessions[]=
+{
+  {"menu", "DDDDDDDDUUUE", session_menu},
+  {"set_point", "UUUUDDERRUUDUE", session_set_point},
+  {"help", "DDDDUUE", session_help},
+  {"label", "RRRRRRUUURDDE", session_label},
+};
+
+static const session *find_session(const std::string &name)
+{
+  for (unsigned i=0;i<sizeof(sessions)/sizeof(sessions[0]);i++)
+  {
+    if (name==sessions[i].name) return &sessions[i];
+  }
+  return 0;
+}
+
+struct trace ///< A trace split into its header and records.
+{
+  std::string name;
+  byte columns, rows;
+  unsigned long start;      // micros() when recording started.
+  std::vector<byte> flags, values;
+  std::vector<unsigned long> times; // Microseconds after recording started.
+};
+
+static bool parse_trace(const std::vector<byte> &data, trace &t)
+{
+  if ((data.size()<11)||memcmp(&data[0],"PHT1",4)) return false;
+  t.columns=data[4];
+  t.rows=data[5];
+  t.start=0;
+  for (byte i=0;i<4;i++) t.start|=(unsigned long)data[6+i]<<(i*8);
+  size_t p=11+data[10];
+  if (p>data.size()) return false;
+  t.name.assign((const char *)&data[11],data[10]);
+  unsigned long time=0;
+  while (p+2<data.size())
+  {
+    byte f=data[p], v=data[p+1];
+    unsigned long delta=0;
+    byte shift=0;
+    p+=2;
+    while (p<data.size())
+    {
+      byte b=data[p++];
+      delta|=(unsigned long)(b&0x7F)<<shift;
+      shift+=7;
+      if (!(b&0x80)) break;
+    }
+    time+=delta;
+    t.flags.push_back(f);
+    t.values.push_back(v);
+    t.times.push_back(time);
+  }
+  return true;
+}
+
+/**
+ * Plays the display bytes of a trace into a simulated screen and takes a picture of the screen before each key and at the end.
+ * Cells showing custom characters are pictured by their CGRAM pattern, so the library may load a glyph into another slot.
+ */
+static std::vector<std::string> screens(const trace &t, unsigned long &bytes, unsigned long &commands)
+{
+  std::vector<std::string> shots;
+  sim_lcd screen;
+  screen.begin(t.columns,t.rows);
+  bytes=commands=0;
+  for (size_t i=0;i<=t.flags.size();i++)
+  {
+    if ((i==t.flags.size())||(t.flags[i]==phi_prompt_trace_key))
+    {
+      std::string shot;
+      for (byte r=0;r<t.rows;r++)
+      {
+        for (byte c=0;c<t.columns;c++)
+        {
+          byte ch=screen.cell(c,r);
+          if (ch<8) shot.append((const char *)&screen.cgram[ch*8],8);
+          else shot+=(char)ch;
+        }
+      }
+      shots.push_back(shot);
+      continue;
+    }
+    if (t.flags[i]&phi_prompt_queued_command)
+    {
+      screen.feed(0xFE);
+      commands++;
+    }
+    screen.feed(t.values[i]);
+    bytes++;
+  }
+  return shots;
+}
+
+static void setup_display(multiple_button_input **keypads)
+{
+  sim_screen.begin(20,4);
+  init_phi_prompt(&lcd,keypads,function_keys,20,4,'~');
+  clear();
+  while (phi_prompt_service());
+  memset(&para,0,sizeof(para)); // Sessions set only the fields their widget uses, so none picks up another's leftovers.
+}
+
+static int record_golden(const char *dir)
+{
+  for (unsigned s=0;s<sizeof(sessions)/sizeof(sessions[0]);s++)
+  {
+    buffer_print out;
+    setup_display(script_keypads);
+    sim_advance_us(session_spacing-micros()%session_spacing); // Start every session on a round time the replay can reach again, whichever traces it is given.
+    script_keypad.script(sessions[s].keys,150);
+    phi_prompt_record(&out,sessions[s].name);
+    sessions[s].run();
+    while (phi_prompt_service());
+    phi_prompt_record(0,0);
+    std::string path=std::string(dir)+"/"+sessions[s].name+".trace";
+    FILE *f=fopen(path.c_str(),"wb");
+    if (f==0)
+    {
+      perror(path.c_str());
+      return 1;
+    }
+    fwrite(&out.data[0],1,out.data.size(),f);
+    fclose(f);
+    printf("%-12s %6u bytes of trace\n", sessions[s].name, (unsigned)out.data.size());
+  }
+  return 0;
+}
+
+static bool load_trace(const char *path, trace &t)
+{
+  std::vector<byte> data;
+  FILE *f=fopen(path,"rb");
+  if (f==0)
+  {
+    perror(path);
+    return false;
+  }
+  int c;
+  while ((c=fgetc(f))!=EOF) data.push_back(c);
+  fclose(f);
+  if (!parse_trace(data,t))
+  {
+    printf("%s: not a phi_prompt trace\n", path);
+    return false;
+  }
+  return true;
+}
+
+static bool replay_trace(const trace &golden)
+{
+  trace now;
+  const session *s=find_session(golden.name);
+  if (s==0)
+  {
+    printf("%s: no session called %s\n", golden.name.c_str(), golden.name.c_str());
+    return false;
+  }
+  replay_keypad.keys.clear();
+  replay_keypad.times.clear();
+  for (size_t i=0;i<golden.flags.size();i++)
+  {
+    if (golden.flags[i]!=phi_prompt_trace_key) continue;
+    replay_keypad.keys.push_back(golden.values[i]);
+    replay_keypad.times.push_back(golden.times[i]);
+  }
+  replay_keypad.next=0;
+  buffer_print out;
+  setup_display(replay_keypads);
+  sim_advance_us(golden.start-micros()-1); // Auto scrolling shows millis()/phi_prompt_scroll_time, so start at the time the recording did. phi_prompt_record() reads the clock once more.
+  replay_keypad.start=golden.start;
+  phi_prompt_record(&out,s->name);
+  s->run();
+  while (phi_prompt_service());
+  phi_prompt_record(0,0);
+  parse_trace(out.data,now);
+  unsigned long golden_bytes, golden_commands, now_bytes, now_commands;
+  std::vector<std::string> golden_screens=screens(golden,golden_bytes,golden_commands), now_screens=screens(now,now_bytes,now_commands);
+  size_t same=0;
+  for (size_t i=0;(i<golden_screens.size())&&(i<now_screens.size());i++)
+  {
+    if (golden_screens[i]==now_screens[i]) same++;
+  }
+  bool ok=(same==golden_screens.size())&&(same==now_screens.size());
+  size_t stream=0; // First display byte that differs.
+  std::vector<byte> golden_stream, now_stream;
+  for (size_t i=0;i<golden.flags.size();i++) if (golden.flags[i]!=phi_prompt_trace_key) golden_stream.push_back(golden.values[i]);
+  for (size_t i=0;i<now.flags.size();i++) if (now.flags[i]!=phi_prompt_trace_key) now_stream.push_back(now.values[i]);
+  while ((stream<golden_stream.size())&&(stream<now_stream.size())&&(golden_stream[stream]==now_stream[stream])) stream++;
+  char differs[24]="same";
+  if ((stream<golden_stream.size())||(stream<now_stream.size())) snprintf(differs,sizeof(differs),"byte %u",(unsigned)stream);
+  printf("%-12s %5u %8lu %8lu %8lu %8lu %8.1f%% %6u/%-3u %10s %s\n", golden.name.c_str(), (unsigned)replay_keypad.keys.size(), golden_bytes, now_bytes, golden_commands, now_commands,
+    golden_bytes?100.0*((double)golden_bytes-now_bytes)/golden_bytes:0.0, (unsigned)same, (unsigned)golden_screens.size(), differs, ok?"ok":"SCREENS DIFFER");
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  if ((argc==3)&&(strcmp(argv[1],"--record")==0)) return record_golden(argv[2]);
+  if (argc<2)
+  {
+    fprintf(stderr,"usage: replay trace...\n       replay --record directory\n");
+    return 2;
+  }
+  printf("%-12s %5s %8s %8s %8s %8s %9s %10s %10s\n", "session", "keys", "bytes", "now", "cmds", "now", "saved", "screens", "stream");
+  int failed=0;
+  std::vector<trace> traces;
+  for (int i=1;i<argc;i++)
+  {
+    traces.push_back(trace());
+    if (!load_trace(argv[i],traces.back()))
+    {
+      traces.pop_back();
+      failed++;
+    }
+  }
+  std::stable_sort(traces.begin(),traces.end(),[](const trace &a, const trace &b) { return a.start<b.start; }); // The clock only runs forward, so replay in the order the traces were recorded.
+  for (size_t i=0;i<traces.size();i++)
+  {
+    if (!replay_trace(traces[i])) failed++;
+  }
+  return failed?1:0;
+}
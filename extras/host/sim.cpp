@@ -0,0 +1,254 @@
+/*
+Host simulator for phi_prompt. See sim.h.
+*/
+#include "sim.h"
+#include <Wire.h>
+
+HardwareSerial Serial;
+TwoWire Wire;
+sim_lcd sim_screen;
+sim_counters sim_count;
+static unsigned long long now_us=0;
+
+void sim_advance_us(unsigned long us)
+{
+  now_us+=us;
+}
+
+unsigned long millis()
+{
+  now_us++; // Reading the clock is not free, and busy loops must see time pass.
+  return (unsigned long)(now_us/1000);
+}
+
+unsigned long micros()
+{
+  now_us++;
+  return (unsigned long)now_us;
+}
+
+void delay(unsigned long ms)
+{
+  sim_count.delay_ms+=ms;
+  now_us+=ms*1000ULL;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  now_us+=us;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len=strlen(src);
+  if (size)
+  {
+    size_t n=(len>=size)?size-1:len;
+    memcpy(dst, src, n);
+    dst[n]=0;
+  }
+  return len;
+}
+
+void sim_reset_counters()
+{
+  memset(&sim_count, 0, sizeof(sim_count));
+}
+
+size_t SoftwareSerial::write(uint8_t b)
+{
+  unsigned long us=10000000UL/baud; // Start bit, 8 data bits, stop bit.
+  sim_count.bytes++;
+  sim_count.wire_us+=us;
+  sim_count.blocked_us+=us;
+  now_us+=us;
+  (screen?screen:&sim_screen)->feed(b);
+  return 1;
+}
+
+sim_uart::sim_uart() : baud(9600), tail(0), count(0)
+{
+}
+
+void sim_uart::begin(unsigned long speed)
+{
+  flush();
+  baud=speed;
+}
+
+void sim_uart::drain()
+{
+  while (count&&(done_us[tail]<=now_us))
+  {
+    sim_count.bytes++;
+    sim_count.wire_us+=10000000UL/baud;
+    sim_screen.feed(buffer[tail]);
+    tail=(tail+1)%sim_uart_buffer;
+    count--;
+  }
+}
+
+size_t sim_uart::write(uint8_t b)
+{
+  drain();
+  if (count==sim_uart_buffer-1) // Full. Wait for the interrupt to take a byte out like the Arduino core does.
+  {
+    sim_count.blocked_us+=done_us[tail]-now_us;
+    now_us=done_us[tail];
+    drain();
+  }
+  unsigned long long start=count?done_us[(tail+count-1)%sim_uart_buffer]:now_us;
+  byte head=(tail+count)%sim_uart_buffer;
+  buffer[head]=b;
+  done_us[head]=start+10000000UL/baud;
+  count++;
+  return 1;
+}
+
+int sim_uart::availableForWrite()
+{
+  drain();
+  return sim_uart_buffer-1-count;
+}
+
+void sim_uart::flush()
+{
+  if (count)
+  {
+    unsigned long long last=done_us[(tail+count-1)%sim_uart_buffer];
+    sim_count.blocked_us+=last-now_us;
+    now_us=last;
+  }
+  drain();
+}
+
+void sim_lcd::begin(byte c, byte r)
+{
+  columns=c;
+  rows=r;
+  memset(ddram, ' ', sizeof(ddram));
+  memset(cgram, 0, sizeof(cgram));
+  address=0;
+  cgram_mode=false;
+  command_pending=false;
+  special_pending=false;
+  cursor_on=false;
+  blink_on=false;
+}
+
+void sim_lcd::feed(byte b)
+{
+  if (special_pending)
+  {
+    special_pending=false; // Backpack setting such as baud rate or backlight. Nothing to show.
+    return;
+  }
+  if (command_pending)
+  {
+    command_pending=false;
+    sim_count.commands++;
+    if (b&0x80)
+    {
+      address=b&0x7F;
+      cgram_mode=false;
+    }
+    else if (b&0x40)
+    {
+      address=b&0x3F;
+      cgram_mode=true;
+    }
+    else if (b==0x01)
+    {
+      memset(ddram, ' ', sizeof(ddram));
+      address=0;
+      cgram_mode=false;
+    }
+    else if ((b&0xF8)==0x08)
+    {
+      cursor_on=(b&0x02)!=0;
+      blink_on=(b&0x01)!=0;
+    }
+    return;
+  }
+  if (b==0xFE)
+  {
+    command_pending=true;
+    return;
+  }
+  if (b==0x7C)
+  {
+    special_pending=true;
+    return;
+  }
+  if (cgram_mode)
+  {
+    cgram[address&0x3F]=b;
+    address=(address+1)&0x3F;
+    return;
+  }
+  ddram[address&0x7F]=b;
+  if (address==0x27) address=0x40; // HD44780 two-line mode address wrap.
+  else if (address==0x67) address=0x00;
+  else address++;
+}
+
+char sim_lcd::cell(byte column, byte row)
+{
+  static const byte offsets[4]={0x00, 0x40, 0x00, 0x40};
+  byte address=offsets[row]+column+((row>=2)?columns:0);
+  return ddram[address&0x7F];
+}
+
+void sim_lcd::dump(FILE *f)
+{
+  fputc('+', f);
+  for (byte c=0;c<columns;c++) fputc('-', f);
+  fputs("+\n", f);
+  for (byte r=0;r<rows;r++)
+  {
+    fputc('|', f);
+    for (byte c=0;c<columns;c++)
+    {
+      char ch=cell(c, r);
+      fputc(((byte)ch<8)?'0'+ch:((byte)ch<32||(byte)ch>126)?'#':ch, f);
+    }
+    fputs("|\n", f);
+  }
+  fputc('+', f);
+  for (byte c=0;c<columns;c++) fputc('-', f);
+  fputs("+\n", f);
+}
+
+sim_keypad::sim_keypad() : keys(""), gap_ms(100), holding(false), due(0), poll_us(100)
+{
+  button_status_t=buttons_up;
+}
+
+void sim_keypad::script(const char *k, unsigned int gap)
+{
+  keys=k;
+  button_status_t=buttons_up;
+  gap_ms=gap;
+  due=millis()+gap;
+}
+
+byte sim_keypad::getKey()
+{
+  now_us+=poll_us;
+  if (!*keys)
+  {
+    if (millis()>due+600000UL)
+    {
+      fputs("sim: key script exhausted while a widget is still waiting\n", stderr);
+      exit(2);
+    }
+    return NO_KEY;
+  }
+  if (millis()<due) return NO_KEY;
+  due=millis()+gap_ms;
+  button_status_t=(holding&&(button_status_t!=buttons_up)&&(keys[-1]==*keys))?buttons_held:buttons_pressed;
+  return (byte)*keys++;
+}
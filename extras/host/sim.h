@@ -0,0 +1,75 @@
+/*
+Host simulator for phi_prompt: a virtual clock, a serial LCD that decodes the 0xFE command stream into a screen, and a scripted keypad.
+*/
+#ifndef phi_prompt_sim_h
+#define phi_prompt_sim_h
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include <phi_interfaces.h>
+
+#define sim_max_columns 40
+#define sim_max_rows 4
+#define sim_uart_buffer 64
+
+struct sim_counters ///< Totals accumulated since the last sim_reset_counters().
+{
+  unsigned long bytes;      // Bytes sent to the display.
+  unsigned long commands;   // 0xFE command sequences sent to the display.
+  unsigned long delay_ms;   // Time spent inside delay().
+  unsigned long wire_us;    // Time spent shifting bytes out on the serial link.
+  unsigned long blocked_us; // Time the CPU waited on the serial link, all of wire_us for SoftwareSerial.
+};
+
+class sim_lcd ///< Decodes the serial LCD protocol into DDRAM/CGRAM like an HD44780 behind a serial backpack.
+{
+  public:
+  void begin(byte columns, byte rows);
+  void feed(byte b);
+  char cell(byte column, byte row);
+  void dump(FILE *f);
+  byte columns, rows;
+  byte ddram[128];
+  byte cgram[64];
+  byte address;             // DDRAM address counter.
+  boolean cgram_mode;       // Data goes to CGRAM after a set-CGRAM-address command.
+  boolean command_pending;  // The previous byte was the 0xFE command flag.
+  boolean special_pending;  // The previous byte was the 0x7C backpack flag.
+  boolean cursor_on, blink_on;
+};
+
+class sim_uart : public HardwareSerial ///< A hardware serial port whose transmit buffer its interrupt empties one byte per byte time into sim_screen. Writes only wait when the buffer is full.
+{
+  public:
+  sim_uart();
+  virtual void begin(unsigned long speed);
+  virtual size_t write(uint8_t b);
+  using Print::write;
+  virtual int availableForWrite();
+  virtual void flush();
+  void drain();             // Hands the bytes that have gone out by now to the screen.
+  long baud;
+  byte buffer[sim_uart_buffer];
+  unsigned long long done_us[sim_uart_buffer]; // Time each buffered byte has gone out.
+  byte tail, count;
+};
+
+class sim_keypad : public multiple_button_input ///< Returns scripted keys, one every gap_ms, and charges poll_us per getKey() call.
+{
+  public:
+  sim_keypad();
+  void script(const char *keys, unsigned int gap_ms);
+  virtual byte getKey();
+  const char *keys;
+  unsigned int gap_ms;
+  boolean holding;          // Reports a key the same as the one before as a repeat of a key held down, instead of a separate tap.
+  unsigned long due;
+  unsigned int poll_us;
+};
+
+extern sim_lcd sim_screen;
+extern sim_counters sim_count;
+void sim_reset_counters();
+void sim_advance_us(unsigned long us);
+
+#endif
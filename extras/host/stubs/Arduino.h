@@ -0,0 +1,94 @@
+/*
+Host stand-in for the parts of the Arduino core that phi_prompt uses.
+Time is virtual: millis() and micros() read the simulator clock, which only moves when delay() is called or the simulated hardware spends time (serial bytes, key polling).
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define B00000001 1
+#define B00000010 2
+#define B00000100 4
+#define B00001000 8
+#define B00010000 16
+#define B00100000 32
+#define B01000000 64
+#define B10000000 128
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+class Print
+{
+  public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n=0;
+    while (size--) n+=write(*buffer++);
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+  size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long n)
+  {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%ld", n);
+    return write(buf);
+  }
+  size_t print(int n) { return print((long)n); }
+  size_t print(unsigned long n)
+  {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%lu", n);
+    return write(buf);
+  }
+  size_t print(unsigned int n) { return print((unsigned long)n); }
+  size_t println(const char *str) { size_t n=print(str); return n+write("\r\n"); }
+  size_t println(long n) { size_t r=print(n); return r+write("\r\n"); }
+  size_t println(unsigned long n) { size_t r=print(n); return r+write("\r\n"); }
+  size_t println() { return write("\r\n"); }
+};
+
+class Stream : public Print
+{
+  public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual void flush() {}
+};
+
+class HardwareSerial : public Stream
+{
+  public:
+  virtual void begin(unsigned long) {}
+  virtual size_t write(uint8_t c) { fputc(c, stdout); return 1; }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,22 @@
+/*
+Host stand-in for SoftwareSerial. Every byte is forwarded to a simulated serial LCD, sim_screen unless screen points to another, which charges the wire time of one byte at the current baud rate to the virtual clock.
+*/
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include <Arduino.h>
+
+class sim_lcd;
+
+class SoftwareSerial : public Stream
+{
+  public:
+  SoftwareSerial(uint8_t rx=0, uint8_t tx=1) : baud(9600), screen(0) { (void)rx; (void)tx; }
+  void begin(long speed) { baud=speed; }
+  virtual size_t write(uint8_t b);
+  using Print::write;
+  long baud;
+  sim_lcd *screen;
+};
+
+#endif
@@ -0,0 +1,21 @@
+/*
+Host stand-in for the Wire library. Transmissions are counted and discarded.
+*/
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <Arduino.h>
+
+class TwoWire
+{
+  public:
+  void begin() {}
+  void beginTransmission(uint8_t) { transmissions++; }
+  size_t write(uint8_t) { bytes++; return 1; }
+  uint8_t endTransmission() { return 0; }
+  unsigned long transmissions, bytes;
+};
+
+extern TwoWire Wire;
+
+#endif
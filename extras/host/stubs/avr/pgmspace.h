@@ -0,0 +1,29 @@
+/*
+Host stand-in for avr/pgmspace.h. Flash and SRAM share one address space on the host, so the _P functions map to their plain counterparts.
+pgm_read_word is used by phi_prompt to fetch pointers out of PROGMEM tables, so it returns a full host pointer.
+*/
+#ifndef host_pgmspace_h
+#define host_pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+template <typename T> inline T host_pgm_read(const T *p) { return *p; }
+
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) ((uintptr_t)host_pgm_read(p))
+#define pgm_read_word_near(p) pgm_read_word(p)
+#define pgm_read_dword(p) ((uint32_t)host_pgm_read(p))
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+#define strcpy_P(d, s) strcpy((d), (s))
+#define strlen_P(s) strlen(s)
+#define strlcpy_P(d, s, n) strlcpy((d), (s), (n))
+#define memcpy_P(d, s, n) memcpy((d), (s), (n))
+
+#endif
@@ -0,0 +1,28 @@
+/*
+Host stand-in for the phi_interfaces keypad base class. Only the interface phi_prompt calls is modelled.
+*/
+#ifndef phi_interfaces_h
+#define phi_interfaces_h
+
+#include <Arduino.h>
+
+#define NO_KEY 0
+#define buttons_up 0
+#define buttons_pressed 1
+#define buttons_down 2
+#define buttons_held 3
+#define buttons_released 4
+#define buttons_debounce 5
+
+class multiple_button_input
+{
+  public:
+  virtual ~multiple_button_input() {}
+  virtual byte getKey()=0;
+  byte get_status() { return button_status_t; } // buttons_held when getKey() returned a repeat of a key held down.
+  void set_repeat(int r) { repeat=r; }
+  int repeat;
+  byte button_status_t;
+};
+
+#endif
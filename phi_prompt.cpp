@@ -31,6 +31,17 @@ This resulted in compilation errors such as "'prog_char' does not name a type".
 #include <avr/pgmspace.h>
 #include <phi_interfaces.h>
 #include <phi_prompt.h>
+#if defined(phi_prompt_timer2_keys) && defined(__AVR__)
+#define phi_prompt_keys_in_isr      // Keypads are scanned from the Timer2 interrupt and nowhere else.
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+static void start_key_timer();
+#endif
+static void place_cursor(int posNum, int lineNum);
+static void text_prev_line(phi_prompt_struct* para);
+static void text_next_line(phi_prompt_struct* para);
+static void text_long_msg(phi_prompt_struct* para);
 
 const char phi_prompt_lcd_ch0[] PROGMEM = { 4,14,31,64,31,31,31,31,0}; ///< Custom LCD character: Up triangle with block
 const char phi_prompt_lcd_ch1[] PROGMEM = { 4,14,31,64,64,64,64,64,0}; ///< Custom LCD character: Up triangle 
@@ -38,87 +49,318 @@ const char phi_prompt_lcd_ch2[] PROGMEM = {31,31,31,31,64,64,64,64,0}; ///< Cust
 const char phi_prompt_lcd_ch3[] PROGMEM = {64,64,64,64,31,31,31,31,0}; ///< Custom LCD character: Bottom block
 const char phi_prompt_lcd_ch4[] PROGMEM = {64,64,64,64,64,31,14, 4,0}; ///< Custom LCD character: Down triangle
 const char phi_prompt_lcd_ch5[] PROGMEM = {31,31,31,31,64,31,14, 4,0}; ///< Custom LCD character: Down triangle with block
-const char* const phi_prompt_lcd_ch_item[] PROGMEM = {phi_prompt_lcd_ch0, phi_prompt_lcd_ch1, phi_prompt_lcd_ch2, phi_prompt_lcd_ch3, phi_prompt_lcd_ch4, phi_prompt_lcd_ch5}; ///< Custom LCD character char array addresses. 
+const char phi_prompt_lcd_bar1[] PROGMEM = {16,16,16,16,16,16,16,16}; ///< Custom LCD character: Bar gauge cell 1/5 full
+const char phi_prompt_lcd_bar2[] PROGMEM = {24,24,24,24,24,24,24,24}; ///< Custom LCD character: Bar gauge cell 2/5 full
+const char phi_prompt_lcd_bar3[] PROGMEM = {28,28,28,28,28,28,28,28}; ///< Custom LCD character: Bar gauge cell 3/5 full
+const char phi_prompt_lcd_bar4[] PROGMEM = {30,30,30,30,30,30,30,30}; ///< Custom LCD character: Bar gauge cell 4/5 full
+
+const char phi_prompt_tap_keys[] PROGMEM = "0123456789"; ///< Keys that multi-tap by default
+const char phi_prompt_tap_0[] PROGMEM = " 0";         ///< Characters key 0 cycles through
+const char phi_prompt_tap_1[] PROGMEM = ".,-?!1";     ///< Characters key 1 cycles through
+const char phi_prompt_tap_2[] PROGMEM = "ABC2";       ///< Characters key 2 cycles through
+const char phi_prompt_tap_3[] PROGMEM = "DEF3";       ///< Characters key 3 cycles through
+const char phi_prompt_tap_4[] PROGMEM = "GHI4";       ///< Characters key 4 cycles through
+const char phi_prompt_tap_5[] PROGMEM = "JKL5";       ///< Characters key 5 cycles through
+const char phi_prompt_tap_6[] PROGMEM = "MNO6";       ///< Characters key 6 cycles through
+const char phi_prompt_tap_7[] PROGMEM = "PQRS7";      ///< Characters key 7 cycles through
+const char phi_prompt_tap_8[] PROGMEM = "TUV8";       ///< Characters key 8 cycles through
+const char phi_prompt_tap_9[] PROGMEM = "WXYZ9";      ///< Characters key 9 cycles through
+const char* const phi_prompt_tap_charsets[] PROGMEM = {phi_prompt_tap_0, phi_prompt_tap_1, phi_prompt_tap_2, phi_prompt_tap_3, phi_prompt_tap_4, phi_prompt_tap_5, phi_prompt_tap_6, phi_prompt_tap_7, phi_prompt_tap_8, phi_prompt_tap_9}; ///< Characters each multi-tap key cycles through, in the order of phi_prompt_tap_keys
 
 const char yn_00[] PROGMEM = " YES >NO<";          ///< This list item is used to render Y/N dialog
 const char yn_01[] PROGMEM = ">YES< NO ";          ///< This list item is used to render Y/N dialog
 const char* const yn_items[]= {yn_00,yn_01};  ///< This list  is used to render Y/N dialog
 
-static SoftwareSerial * lcd;                 ///< This pointer stores the SoftwareSerial object for display purpose.
-static int lcd_w;                           ///< This is the width of the LCD in number of characters.
-static int lcd_h;                           ///< This is the height of the LCD in number of characters.
-static char indicator;                      ///< This is the character used as indicator in lists/menus. The highlighted item is indicated by this character. Use '~' for a right arrow.
-static char bullet;                         ///< This is the bullet used in lists/menus. The non-highlighted items are indicated by this character. Use '\xA5' for a center dot.
-static char ** function_keys;               ///< This points to an array of pointers that each is a zero-terminated string representing function keys.
-static multiple_button_input ** mbi_ptr;    ///< This points to an array of pointers that each points to a multiple_button_input object.
-static byte lcd_type;                       ///< This indicates the type of lcd, such as HD44780 or GLCD.
-static boolean key_repeat_enable=1;         ///< This is not used in this version. A future version may make use of it.
-static boolean multi_tap_enable=0;          ///< This is not used in this version. A future version may make use of it.
-static phi_prompt_struct shared_struct;     ///< This struct is shared among simple function calls.
+static phi_prompt_context default_context;   ///< This is the context used until phi_prompt_bind() binds another.
+static phi_prompt_context * ctx=&default_context; ///< This is the context all functions work on.
+static phi_prompt_context * contexts=0;      ///< This is the list of contexts init_phi_prompt() has set up, linked through next.
+#ifdef phi_prompt_stats
+#define count_stat(counter,n) (ctx->stats.counter+=(n))
+#else
+#define count_stat(counter,n)
+#endif
 //Utilities
+/**
+ * \details Sets up a context with nothing bound. init_phi_prompt() fills in the rest once the context is bound.
+ */
+phi_prompt_context::phi_prompt_context() : serial_display(0)
+{
+  lcd=0;
+  function_keys=0;
+  mbi_ptr=0;
+  key_repeat_enable=1;
+  multi_tap_enable=0;
+  tap_keys=phi_prompt_tap_keys;
+  tap_charsets=phi_prompt_tap_charsets;
+  shadow=0;
+  shadow_dirty=0;
+  shadow_unknown=0;
+  shadow_cells=0;
+  cursor_col=0;
+  cursor_row=0;
+  hw_address=255;
+  display_control=0;
+  for (byte i=0;i<8;i++)
+  {
+    glyph_ids[i]=0;
+    glyph_lru[i]=i;
+  }
+  glyph_pinned=0;
+  queue_total=0;
+  queue_head=0;
+  queue_tail=0;
+  queue_count=0;
+  queue_ready=0;
+  settle_pending=0;
+  key_head=0;
+  key_tail=0;
+  key_repeats=0;
+  held_key=NO_KEY;
+  line_starts=0;
+  line_capacity=0;
+  line_count=0;
+  line_msg=0;
+  scratch=0;
+  scratch_size=0;
+  scratch_used=0;
+  scratch_peak=0;
+  next=0;
+#ifdef phi_prompt_stats
+  memset(&stats,0,sizeof(stats));
+  widget=0;
+  stats_mark=0;
+  trace=0;
+  record_out=0;
+  record_previous=0;
+#endif
+}
+
+/**
+ * \details Makes all phi_prompt functions work on another user interface, such as a second display with its own keypads. Bind a context before calling init_phi_prompt() for it.
+ * Tasks remember the context they were started in, so phi_prompt_poll() runs each task on its own display whatever is bound.
+ * Binding doesn't change the list of contexts whose keypads are scanned, so it needs no care with phi_prompt_timer2_keys. Only init_phi_prompt() changes that list.
+ * \param context This is the context to bind, or 0 for the one used before any was bound.
+ * \return It returns the context that was bound, so a caller can bind it again when done.
+ */
+phi_prompt_context *phi_prompt_bind(phi_prompt_context *context)
+{
+  phi_prompt_context *previous=ctx;
+  ctx=(context!=0)?context:&default_context;
+  return previous;
+}
+
+/**
+ * \details Takes n bytes of the scratch arena for text on its way to the display. Give them back with scratch_give() in the reverse order they were taken.
+ * \return It returns 0 if the arena doesn't have n bytes left, such as for a field wider than the display, and the caller draws nothing.
+ */
+static char *scratch_take(int n)
+{
+  if (n>ctx->scratch_size-ctx->scratch_used) return 0;
+  char *p=ctx->scratch+ctx->scratch_used;
+  ctx->scratch_used+=n;
+  if (ctx->scratch_used>ctx->scratch_peak) ctx->scratch_peak=ctx->scratch_used;
+  return p;
+}
+
+/**
+ * \details Gives back the bytes of the scratch arena from p on.
+ */
+static void scratch_give(char *p)
+{
+  ctx->scratch_used=p-ctx->scratch;
+}
+
+/**
+ * \details Reports how much of the scratch arena renderers have needed, so you can see what SRAM the library uses besides the stack.
+ * \param size If not 0, this receives the size of the arena, which init_phi_prompt() sets from the display width.
+ * \return It returns the most bytes of the scratch arena of the bound context in use at once since init_phi_prompt().
+ */
+int phi_prompt_scratch_peak(int *size)
+{
+  if (size!=0) *size=ctx->scratch_size;
+  return ctx->scratch_peak;
+}
+
 /**
  * \details This initializes the phi_prompt library. It needs to be called before any phi_prompt functions are called.
- * \param l This is the address of your LCD object, which you already used begin() on, such as &LCD.
+ * \param d This is the address of your display driver object, which you already used begin() on, such as &lcd_driver.
  * \param k This is the name of the pointer array that stores the address of (pointer to) all your input keypads. The last element of the array needs to be 0 to terminate the array.
  * \param fk This is the name of the array that stores the names of all char arrays with function keys. Make sure you use strings such as "U" for each array to indicate function keys instead of char like 'U'.
  * \param w This is the width of the LCD in number of characters.
  * \param h This is the height of the LCD in number of characters.
  * \param i This is the character used as indicator in lists/menus. The highlighted item is indicated by this character. Use '~' for a right arrow.
  */
-void init_phi_prompt(SoftwareSerial *l, multiple_button_input *k[], char ** fk, int w, int h, char i)
+void init_phi_prompt_driver(phi_prompt_display *d, multiple_button_input *k[], char ** fk, int w, int h, char i)
 {
-  lcd=l;
-  mbi_ptr=k;
-  function_keys=fk;
-  lcd_w=w;
-  lcd_h=h;
-  indicator=i;
-  bullet='\xA5';
-  byte ch_buffer[10]; // This buffer is required for custom characters on the LCD.
-  if (lcd!=0)
+  ctx->lcd=d;
+  ctx->function_keys=fk;
+  memset(ctx->key_table,0,sizeof(ctx->key_table));
+  for (byte f=total_function_keys;f>0;f--) // Go backwards so a key listed under two functions keeps the first, as the string search did.
   {
-    for (int i=0;i<6;i++)
+    for (byte j=0;ctx->function_keys[f-1][j];j++)
     {
-      strcpy_P((char*)ch_buffer,(char*)pgm_read_word(&(phi_prompt_lcd_ch_item[i])));
-      createChar(i, ch_buffer);
+      set_function_key(ctx->function_keys[f-1][j],function_key_code_base+f-1);
     }
   }
-  lcd_type=HD44780_lcd;
+  ctx->lcd_w=w;
+  ctx->lcd_h=h;
+  ctx->indicator=i;
+  ctx->bullet='\xA5';
+  if (ctx->shadow_cells<w*h) // Allocate the shadow once. A later init with the same or smaller display reuses it.
+  {
+    free(ctx->shadow);
+    free(ctx->shadow_dirty);
+    free(ctx->shadow_unknown);
+    ctx->shadow=(char*)malloc(w*h);
+    ctx->shadow_dirty=(byte*)malloc((w*h+7)/8);
+    ctx->shadow_unknown=(byte*)malloc((w*h+7)/8);
+    if ((ctx->shadow==0)||(ctx->shadow_dirty==0)||(ctx->shadow_unknown==0)) // Out of SRAM. Fall back to writing straight to the display.
+    {
+      free(ctx->shadow);
+      free(ctx->shadow_dirty);
+      free(ctx->shadow_unknown);
+      ctx->shadow=0;
+      ctx->shadow_dirty=0;
+      ctx->shadow_unknown=0;
+      ctx->shadow_cells=0;
+    }
+    else
+    {
+      ctx->shadow_cells=w*h;
+      memset(ctx->shadow,' ',w*h); // malloc() leaves garbage, which could pass for glyph codes 0-15.
+    }
+  }
+  if (ctx->shadow)
+  {
+    memset(ctx->shadow_dirty,0,(w*h+7)/8);
+    phi_prompt_invalidate(); // Whatever the display shows now was not written by this library.
+  }
+  int scratch_size=((w>2*phi_prompt_format_digits)?w:2*phi_prompt_format_digits)+2; // A line with an indicator and the terminating 0, or the current/total index of a list.
+  if (ctx->scratch_size<scratch_size) // Like the shadow, allocate once and reuse it for a display that is no wider.
+  {
+    free(ctx->scratch);
+    ctx->scratch=(char*)malloc(scratch_size);
+    ctx->scratch_size=(ctx->scratch!=0)?scratch_size:0; // Out of SRAM: renderers that need the arena draw nothing.
+  }
+  ctx->scratch_used=0;
+  ctx->scratch_peak=0;
+  for (byte i=0;i<8;i++) // Glyphs are uploaded when they are first displayed, into the slots in order, so a session draws the same after every init.
+  {
+    ctx->glyph_ids[i]=0;
+    ctx->glyph_lru[i]=i;
+  }
+#ifdef phi_prompt_stats
+  phi_prompt_reset_stats();
+#endif
+  ctx->glyph_pinned=0;
+  if (ctx->lcd!=0) ctx->lcd_type=ctx->lcd->type();
+#ifdef phi_prompt_keys_in_isr
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // Timer2 walks the list and reads the keypads, and a pointer takes two stores on AVR.
+#endif
+  {
+    ctx->mbi_ptr=k;
+    phi_prompt_context *c=contexts;
+    while ((c!=0)&&(c!=ctx)) c=c->next;
+    if (c==0) // First init of this context. From now on its keypads are scanned and phi_prompt_service_all() feeds its display.
+    {
+      ctx->next=contexts;
+      contexts=ctx;
+    }
+  }
+#ifdef phi_prompt_keys_in_isr
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  start_key_timer();
+#endif
+}
+
+/**
+ * \details This initializes the phi_prompt library for a serial LCD. It wraps the serial port in a phi_prompt_serial_lcd driver and calls init_phi_prompt_driver().
+ * This is the only overload of init_phi_prompt, so init_phi_prompt(0, ...) still compiles as it always has. The other displays have their own names.
+ * \param l This is the address of your SoftwareSerial object, which you already used begin() on, such as &LCD.
+ * The other parameters are the same as init_phi_prompt_driver().
+ */
+void init_phi_prompt(SoftwareSerial *l, multiple_button_input *k[], char ** fk, int w, int h, char i)
+{
+  ctx->serial_display.port=l;
+  ctx->serial_display.buffered=false;
+  init_phi_prompt_driver((l!=0)?&ctx->serial_display:(phi_prompt_display*)0,k,fk,w,h,i);
+}
+
+/**
+ * \details This initializes the phi_prompt library for a serial LCD on a hardware serial port such as Serial1. Bytes go into the port's transmit buffer, which its interrupt empties,
+ * and only as many as fit, so neither your sketch nor other interrupts wait while the display is updated.
+ * \param l This is the address of your HardwareSerial object, which you already used begin() on at the rate the backpack is set to, such as &Serial1.
+ * \param baud This is a faster rate to switch the backpack and the port to, such as 38400, or 0 to stay at the current rate. See phi_prompt_serial_lcd::set_baud().
+ * The other parameters are the same as init_phi_prompt_driver().
+ */
+void init_phi_prompt_hardware_serial(HardwareSerial *l, multiple_button_input *k[], char ** fk, int w, int h, char i, long baud)
+{
+  ctx->serial_display.port=l;
+  ctx->serial_display.buffered=true;
+  ctx->serial_display.capacity=0;
+  if ((baud!=0)&&ctx->serial_display.set_baud(baud))
+  {
+    l->flush(); // The backpack switches once it has the command, so the port has to send it at the old rate.
+    l->begin(baud);
+  }
+  init_phi_prompt_driver(&ctx->serial_display,k,fk,w,h,i);
 }
 
+/**
+ * \details This initializes the phi_prompt library for a serial LCD on a port that is neither a SoftwareSerial nor a HardwareSerial, such as AltSoftSerial.
+ * Not every core reports how much room such a port has, so bytes are written straight to it as they are for SoftwareSerial, and output waits whenever the port does.
+ * Use init_phi_prompt_hardware_serial() for a hardware port so the CPU doesn't wait on the wire.
+ * \param l This is the address of your serial port object, which you already used begin() on.
+ * The other parameters are the same as init_phi_prompt_driver().
+ */
+void init_phi_prompt_stream(Stream *l, multiple_button_input *k[], char ** fk, int w, int h, char i)
+{
+  ctx->serial_display.port=l;
+  ctx->serial_display.buffered=false;
+  init_phi_prompt_driver((l!=0)?&ctx->serial_display:(phi_prompt_display*)0,k,fk,w,h,i);
+}
 
 void set_indicator(char i)
 {
-  indicator=i;
+  ctx->indicator=i;
 }
 
 void set_bullet(char i)
 {
-  bullet=i;
+  ctx->bullet=i;
 }
 
 void set_repeat_time(int i)
 {
-  mbi_ptr[0]->set_repeat(i);
+  ctx->mbi_ptr[0]->set_repeat(i);
 }
 
 void enable_key_repeat(boolean i)
 {
-  key_repeat_enable=i;
+  ctx->key_repeat_enable=i;
 }
 
 void enable_multi_tap(boolean i)
 {
-//if (!multi_tap_enable) multi_tap(init);
-  multi_tap_enable=i;
+  ctx->multi_tap_enable=i;
+}
+
+/**
+ * \details Sets which keys multi-tap in input_panel and the characters each one cycles through. The default is a phone keypad with keys 0-9.
+ * \param keys This is the keys that multi-tap, such as "0123456789", in PROGMEM.
+ * \param charsets This is an array in PROGMEM of the characters each key cycles through, in the order of keys, such as "ABC2" for key 2. The strings are in PROGMEM too.
+ */
+void set_multi_tap_table(PGM_P keys, const char * const *charsets)
+{
+  ctx->tap_keys=keys;
+  ctx->tap_charsets=charsets;
 }
 
 /**
  * \details Increment character ch according to options set in para. This function is used in input panel with up/down key to increment the current character to the next.
  * \param para This is the phi_prompt struct to carry information between callers and functions.
  * Option 0: default, option 1: include 0-9 as valid inputs, option 2: only 0-9 are valid, option 3: only 0-9 are valid and the first digit can be '-', option 4: only 0-9 are valid and number increments, option 5: only 0-9 are valid and the first digit can be '-' and number increments.
- * To do:
- * Option 2-4, automatically increment or decrement a whole series of numbers when they are connected, such as File0009.txt when increase 9 (if only 0-9 are allowed) will give File0010.txt.
+ * With options 4 and 5, input_panel carries into the digits to the left, so File0009.txt increased at the 9 gives File0010.txt.
  * If you are not interested in the inner working of this library, don't call it.
  * \return It returns the character after the increment.
  */
@@ -160,8 +402,7 @@ char inc(char ch, phi_prompt_struct *para)
  * \details Decrement character ch according to options set in para. This function is used in input panel with up/down key to decrement the current character to the previous.
  * \param para This is the phi_prompt struct to carry information between callers and functions.
  * Option 0: default, option 1: include 0-9 as valid inputs, option 2: only 0-9 are valid, option 3: only 0-9 are valid and the first digit can be '-', option 4: only 0-9 are valid and number increments, option 5: only 0-9 are valid and the first digit can be '-' and number increments.
- * To do:
- * Option 2-4, automatically increment or decrement a whole series of numbers when they are connected, such as File0009.txt when increase 9 (if only 0-9 are allowed) will give File0010.txt.
+ * With options 4 and 5, input_panel carries into the digits to the left, so File0009.txt increased at the 9 gives File0010.txt.
  * If you are not interested in the inner working of this library, don't call it.
  * \return It returns the character after the decrement.
  */
@@ -201,24 +442,30 @@ char dec(char ch, phi_prompt_struct *para)// Decrease character. Used in input p
 
 /**
  * \details This function translates key press returned from all keypads. This function is only called by wait_on_escape.
+ * It looks the key up in a table built by init_phi_prompt() and changed by set_function_key().
+ * The table packs two keys to a byte, so it takes 128 bytes of SRAM per display instead of 256, at the cost of a shift and a mask on every lookup.
  * \return If a key is defined as a function key, it returns the code of the function key defined in the function_key_base define section.
  * If the key is not a function key, it returns the key unaltered.
  * If you are not interested in the inner working of this library, don't call it.
  */
 char phi_prompt_translate(char key)
 {
-  for (byte i=0;i<total_function_keys;i++)
-  {
-    byte j=0;
-    while(function_keys[i][j])
-    {
-      if (key==function_keys[i][j]) return (function_key_code_base+i);
-      j++;
-    }
-  }
+  byte function=(ctx->key_table[(byte)key>>1]>>(((byte)key&1)<<2))&0x0F;
+  if (function) return (function_key_code_base+function-1);
   return key;
 }
 
+/**
+ * \details Makes a key act as a function key, or as a plain key again, without changing the function key strings given to init_phi_prompt().
+ * \param key This is the key as the keypad reports it, such as 'A'.
+ * \param function This is the function key code, such as phi_prompt_up, or 0 for a plain key.
+ */
+void set_function_key(char key, byte function)
+{
+  byte shift=((byte)key&1)<<2, code=(function>=function_key_code_base)?function-function_key_code_base+1:0;
+  ctx->key_table[(byte)key>>1]=(ctx->key_table[(byte)key>>1]&~(0x0F<<shift))|(code<<shift);
+}
+
 //Text renderers
 
 /**
@@ -228,45 +475,56 @@ char phi_prompt_translate(char key)
  */
 void center_text(char * src)
 {
-  char msg_buffer[21];
+  char *msg_buffer=scratch_take(ctx->lcd_w+1);
+  if (msg_buffer==0) return;
   byte j=0;
-  for (byte i=0;i<lcd_w;i++)
+  for (byte i=0;i<ctx->lcd_w;i++)
   {
-    if (i<lcd_w/2-(strlen(src)-strlen(src)/2)) msg_buffer[i]='>';
-    else if (i>=lcd_w/2+strlen(src)/2) msg_buffer[i]='<';
+    if (i<ctx->lcd_w/2-(strlen(src)-strlen(src)/2)) msg_buffer[i]='>';
+    else if (i>=ctx->lcd_w/2+strlen(src)/2) msg_buffer[i]='<';
     else 
     {
       msg_buffer[i]=src[j];
       j++;
     }
   }
-  msg_buffer[lcd_w]=0; // Terminate the string
-  lcd->print(msg_buffer);
+  msg_buffer[ctx->lcd_w]=0; // Terminate the string
+  phi_prompt_print(msg_buffer);
+  scratch_give(msg_buffer);
+  phi_prompt_flush();
 }
 
 /**
- * \details This copies the right amount of text into a narrow space so it can be displayed and scrolled to show the entire message.
- * If you are not very interested in the inner working of this library, this is not for you. It is used to auto scroll long list items.
- * \param src This points to the long string that needs to be scrolled inside a narrow line.
- * \param dst This points to the buffer that has a length of the narrow line width + 1 (for 0 termination). The part of the text that will be displayed is copied to this buffer after the function call.
- * \param dst_len This is the width of the narrow line. Only this many characters from the source will be copied to the dst buffer.
- * \param pos This is the position of the long text. When pos=0, the text's first portion displays left justified in the dst buffer. When pos<0, spaces are padded before the text, useful for scrolling from right to left. When pos>dst_len, space is padded to the end of the text to make it scroll all the way to the left and eventually disappear. 
- * \return It returns the text to be displayed in the buffer and no value is directly returned.
+ * \details This does the work of scroll_text and scroll_text_P once the length of the source is known, so callers that already know it don't scan the source again.
  */
-void scroll_text(char * src, char * dst, char dst_len, short pos)
+static void scroll_window(const char * src, int src_len, boolean in_progmem, char * dst, byte dst_len, short pos)
 {
   for (byte j=0;j<dst_len;j++)
   {
-    if ((pos<0)||(pos>strlen(src)-1))
+    if ((pos<0)||(pos>=src_len))
     {
       dst[j]=' ';
     }
-    else dst[j]=src[pos];
+    else dst[j]=in_progmem?pgm_read_byte_near(src+pos):src[pos];
     pos++;
   }
   dst[dst_len]=0;
 }
 
+/**
+ * \details This copies the right amount of text into a narrow space so it can be displayed and scrolled to show the entire message.
+ * If you are not very interested in the inner working of this library, this is not for you. It is used to auto scroll long list items.
+ * \param src This points to the long string that needs to be scrolled inside a narrow line.
+ * \param dst This points to the buffer that has a length of the narrow line width + 1 (for 0 termination). The part of the text that will be displayed is copied to this buffer after the function call.
+ * \param dst_len This is the width of the narrow line. Only this many characters from the source will be copied to the dst buffer.
+ * \param pos This is the position of the long text. When pos=0, the text's first portion displays left justified in the dst buffer. When pos<0, spaces are padded before the text, useful for scrolling from right to left. When pos>dst_len, space is padded to the end of the text to make it scroll all the way to the left and eventually disappear. 
+ * \return It returns the text to be displayed in the buffer and no value is directly returned.
+ */
+void scroll_text(char * src, char * dst, char dst_len, short pos)
+{
+  scroll_window(src, strlen(src), false, dst, dst_len, pos);
+}
+
 /**
  * \details This copies the right amount of text (stored in PROGMEM) into a narrow space so it can be displayed and scrolled to show the entire message.
  * If you are not very interested in the inner working of this library, this is not for you. It is used to auto scroll long list items.
@@ -278,27 +536,165 @@ void scroll_text(char * src, char * dst, char dst_len, short pos)
  */
 void scroll_text_P(PGM_P src, char * dst, char dst_len, short pos)
 {
-  for (byte j=0;j<dst_len;j++)
+  scroll_window(src, strlen_P(src), true, dst, dst_len, pos);
+}
+
+/**
+ * \details This is a quick and easy way to display a string in the PROGMEM to the LCD. Only as many characters as the display is wide are shown.
+ * \param msg_line This is the name of the char string stored in PROGMEM.
+ */
+void msg_lcd(char* msg_line)
+{
+  char *msg_buffer=scratch_take(ctx->lcd_w+1);
+  if (msg_buffer==0) return;
+  strlcpy_P(msg_buffer,msg_line,ctx->lcd_w+1);
+  phi_prompt_print(msg_buffer);
+  scratch_give(msg_buffer);
+  phi_prompt_flush();
+}
+
+/**
+ * \details Gives text areas a buffer to keep the start of every line of the message they display, so moving between lines and rendering no longer scan the message.
+ * The index is built the first time a text area uses a message and rebuilt when the message or the number of columns changes.
+ * A message in SRAM is indexed again by every text_area(), long_msg_lcd(), prev_line() and next_line() call from the sketch, since the sketch may have put new text in the same buffer. Only a running text area keeps its index between keys.
+ * If the message has more lines than the buffer holds, text areas scan the message as if there was no index.
+ * \param buffer This is an array of int with one element per line. Pass 0 to stop using an index.
+ * \param size This is the number of elements in the array.
+ */
+void set_line_index(int *buffer, int size)
+{
+  ctx->line_starts=buffer;
+  ctx->line_capacity=size;
+  ctx->line_count=0;
+  ctx->line_msg=0;
+}
+
+/**
+ * \details Forgets the line index of a message in SRAM. The sketch may have put new text in the same buffer, so the index is only trusted while a text area runs.
+ */
+static void drop_sram_line_index()
+{
+  if (!ctx->line_in_progmem) ctx->line_msg=0;
+}
+
+/**
+ * \details Reads a character of a long message stored either in SRAM or in PROGMEM.
+ */
+static char msg_char(phi_prompt_struct* para, boolean in_progmem, int i)
+{
+  if (in_progmem) return pgm_read_byte_near(para->ptr.msg_P+i);
+  return para->ptr.msg[i];
+}
+
+/**
+ * \details Makes sure the line index is for the message in para, building it if needed. Lines break the same way as next_line() moves.
+ * \return It returns true if the index can be used.
+ */
+static boolean line_index_ready(phi_prompt_struct* para, boolean in_progmem)
+{
+  byte columns=para->step.c_arr[1];
+  if ((ctx->line_starts==0)||(columns==0)) return false;
+  if ((ctx->line_msg==para->ptr.msg)&&(ctx->line_columns==columns)&&(ctx->line_in_progmem==in_progmem)) return (ctx->line_count>0);
+  ctx->line_msg=para->ptr.msg;
+  ctx->line_columns=columns;
+  ctx->line_in_progmem=in_progmem;
+  ctx->line_length=in_progmem?strlen_P(para->ptr.msg_P):strlen(para->ptr.msg);
+  ctx->line_current=0;
+  ctx->line_count=0;
+  int start=0;
+  while (true)
   {
-    if ((pos<0)||(pos>strlen_P(src)-1))
+    if (ctx->line_count==ctx->line_capacity) // The message doesn't fit. Go without index.
     {
-      dst[j]=' ';
+      ctx->line_count=0;
+      break;
     }
-    else dst[j]=pgm_read_byte_near(src+pos);
-    pos++;
+    ctx->line_starts[ctx->line_count++]=start;
+    int i;
+    for (i=start;i<start+columns;i++)
+    {
+      if ((msg_char(para,in_progmem,i)=='\n')||(i==ctx->line_length)) break;
+    }
+    if (i==start+columns) start+=columns;
+    else if (i==ctx->line_length) break; // Last line
+    else start=i+1; // Next paragraph
   }
-  dst[dst_len]=0;
+  return (ctx->line_count>0);
 }
 
 /**
- * \details This is a quick and easy way to display a string in the PROGMEM to the LCD. Note the string should have a maximum of 20 characters.
- * \param msg_line This is the name of the char string stored in PROGMEM.
+ * \details Finds the line of the index that starts at pos. The line found last time is checked first, so moving one line at a time needs no search.
+ * \return It returns the line or -1 if pos is not the start of a line.
  */
-void msg_lcd(char* msg_line)
+static int line_of(int pos)
+{
+  if ((ctx->line_current<ctx->line_count)&&(ctx->line_starts[ctx->line_current]==pos)) return ctx->line_current;
+  int low=0, high=ctx->line_count-1;
+  while (low<=high)
+  {
+    int mid=(low+high)/2;
+    if (ctx->line_starts[mid]==pos) return (ctx->line_current=mid);
+    if (ctx->line_starts[mid]<pos) low=mid+1;
+    else high=mid-1;
+  }
+  return -1;
+}
+
+/**
+ * \details Moves a long message one line up or down using the line index.
+ * \return It returns false if the index can't be used, so the caller needs to scan the message.
+ */
+static boolean seek_indexed_line(phi_prompt_struct* para, boolean in_progmem, boolean down)
+{
+  if (!line_index_ready(para,in_progmem)) return false;
+  int line=line_of(para->low.i);
+  if (line<0) return false;
+  if (down)
+  {
+    if (line+1<ctx->line_count) line++;
+  }
+  else if (line>0) line--;
+  ctx->line_current=line;
+  para->low.i=ctx->line_starts[line];
+  return true;
+}
+
+/**
+ * \details Renders a long message from the line index. Each row is copied straight from where its line starts, with no scanning.
+ * \return It returns false if the index can't be used, so the caller needs to render by scanning the message.
+ */
+static boolean long_msg_indexed(phi_prompt_struct* para, boolean in_progmem)
 {
-  char msg_buffer[21];
-  strcpy_P(msg_buffer,msg_line); 
-  lcd->print(msg_buffer);
+  byte columns=para->step.c_arr[1], rows=para->step.c_arr[0];
+  if (!line_index_ready(para,in_progmem)) return false;
+  int first=line_of(para->low.i);
+  if (first<0) return false;
+  for (byte i=0;i<rows;i++)
+  {
+    int pos=(first+i<ctx->line_count)?ctx->line_starts[first+i]:ctx->line_length, end=pos+columns;
+    if (end>ctx->line_length) end=ctx->line_length;
+    place_cursor(para->col,para->row+i);
+    for (byte j=0;j<columns;j++)
+    {
+      char ch=(pos<end)?msg_char(para,in_progmem,pos):'\n';
+      if (ch=='\n')
+      {
+        phi_prompt_write(' ');
+        pos=end;
+      }
+      else
+      {
+        phi_prompt_write(ch);
+        pos++;
+      }
+    }
+  }
+  if ((para->option==1)&&(ctx->line_length>0))
+  {
+    scroll_bar_v(((long)para->low.i)*100/ctx->line_length,para->col+columns,para->row,rows);
+  }
+  phi_prompt_flush();
+  return true;
 }
 
 /**
@@ -309,8 +705,18 @@ void msg_lcd(char* msg_line)
  * Return values are updated throught the struct.
  */
 void prev_line(phi_prompt_struct* para)
+{
+  drop_sram_line_index();
+  text_prev_line(para);
+}
+
+/**
+ * \details Does the work of prev_line(). text_area calls this directly so the line index it built for the message stays in use between keys.
+ */
+static void text_prev_line(phi_prompt_struct* para)
 {
   byte columns=para->step.c_arr[1];
+  if (seek_indexed_line(para,false,false)) return;
   if (para->low.i<=0)
   {
     para->low.i=0;
@@ -319,15 +725,7 @@ void prev_line(phi_prompt_struct* para)
   if (para->ptr.msg[para->low.i-1]=='\n')
   { //Seek beginning of a paragraph.
     int dec=para->low.i-2;
-    while(para->ptr.msg[dec]!='\n')
-    {
-      dec--;
-      if (dec==0)
-      {
-        para->low.i=0;
-        return;
-      }
-    }
+    while((dec>=0)&&(para->ptr.msg[dec]!='\n')) dec--; // dec ends up -1 if this is the first paragraph.
     para->low.i-=((para->low.i-1-dec-1)%columns+1);
   }
 
@@ -343,8 +741,19 @@ void prev_line(phi_prompt_struct* para)
  * Return values are updated throught the struct.
  */
 void next_line(phi_prompt_struct* para)
+{
+  drop_sram_line_index();
+  text_next_line(para);
+}
+
+/**
+ * \details Does the work of next_line(). text_area calls this directly so the line index it built for the message stays in use between keys.
+ */
+static void text_next_line(phi_prompt_struct* para)
 {
   byte columns=para->step.c_arr[1];
+  if (seek_indexed_line(para,false,true)) return;
+  int len=strlen(para->ptr.msg);
   for (int i=para->low.i;i<para->low.i+columns;i++)
   {
     if (para->ptr.msg[i]=='\n')
@@ -353,7 +762,7 @@ void next_line(phi_prompt_struct* para)
       return;
     }
 
-    if (i==strlen(para->ptr.msg))
+    if (i==len)
     {
       return;
     }
@@ -371,6 +780,7 @@ void next_line(phi_prompt_struct* para)
 void prev_line_P(phi_prompt_struct* para)
 {
   byte columns=para->step.c_arr[1];
+  if (seek_indexed_line(para,true,false)) return;
   if (para->low.i<=0)
   {
     para->low.i=0;
@@ -379,15 +789,7 @@ void prev_line_P(phi_prompt_struct* para)
   if (pgm_read_byte_near(para->ptr.msg_P+para->low.i-1)=='\n')
   { //Seek beginning of a paragraph.
     int dec=para->low.i-2;
-    while(pgm_read_byte_near(para->ptr.msg_P+dec)!='\n')
-    {
-      dec--;
-      if (dec==0)
-      {
-        para->low.i=0;
-        return;
-      }
-    }
+    while((dec>=0)&&(pgm_read_byte_near(para->ptr.msg_P+dec)!='\n')) dec--; // dec ends up -1 if this is the first paragraph.
     para->low.i-=((para->low.i-1-dec-1)%columns+1);
   }
 
@@ -405,6 +807,8 @@ void prev_line_P(phi_prompt_struct* para)
 void next_line_P(phi_prompt_struct* para)
 {
   byte columns=para->step.c_arr[1];
+  if (seek_indexed_line(para,true,true)) return;
+  int len=strlen_P(para->ptr.msg_P);
   for (int i=para->low.i;i<para->low.i+columns;i++)
   {
     if (pgm_read_byte_near(para->ptr.msg_P+i)=='\n')
@@ -413,7 +817,7 @@ void next_line_P(phi_prompt_struct* para)
       return;
     }
 
-    if (i==strlen_P(para->ptr.msg_P))
+    if (i==len)
     {
       return;
     }
@@ -429,24 +833,35 @@ void next_line_P(phi_prompt_struct* para)
  * Return values are updated throught the struct.
  */
 void long_msg_lcd(phi_prompt_struct* para)
+{
+  drop_sram_line_index();
+  text_long_msg(para);
+}
+
+/**
+ * \details Does the work of long_msg_lcd(). text_area calls this directly so the line index it built for the message stays in use between keys.
+ */
+static void text_long_msg(phi_prompt_struct* para)
 {
   byte columns=para->step.c_arr[1], rows=para->step.c_arr[0], ch, inc=0;
+  if (long_msg_indexed(para,false)) return;
+  int len=strlen(para->ptr.msg);
 //  noBlink();
   for (byte i=0;i<rows;i++)
   {
-    if ((para->low.i+inc>=strlen(para->ptr.msg))||(para->ptr.msg[para->low.i+inc]=='\n'))
+    if ((para->low.i+inc>=len)||(para->ptr.msg[para->low.i+inc]=='\n'))
     {
       ch=0;
       inc++;
     }
     else ch=para->ptr.msg[para->low.i+inc];
-    setCursor(para->col,para->row+i);
+    place_cursor(para->col,para->row+i);
     for (byte j=0;j<columns;j++)
     {
-      if (ch==0) lcd->write(' ');
+      if (ch==0) phi_prompt_write(' ');
       else
       {
-        lcd->write(ch);
+        phi_prompt_write(ch);
         ch=para->ptr.msg[para->low.i+(++inc)];
         if ((ch=='\n')&&(j<columns-1))
         {
@@ -456,10 +871,11 @@ void long_msg_lcd(phi_prompt_struct* para)
       }
     }
   }
-  if (para->option==1)
+  if ((para->option==1)&&(len>0))
   {
-    scroll_bar_v(((long)para->low.i)*100/strlen(para->ptr.msg),para->col+columns,para->row,rows);
+    scroll_bar_v(((long)para->low.i)*100/len,para->col+columns,para->row,rows);
   }
+  phi_prompt_flush();
 }
 
 /**
@@ -472,22 +888,24 @@ void long_msg_lcd(phi_prompt_struct* para)
 void long_msg_lcd_P(phi_prompt_struct* para) // Displays a long message stored in PROGMEM that could span multiple lines.
 {
   byte columns=para->step.c_arr[1], rows=para->step.c_arr[0], ch, inc=0;
+  if (long_msg_indexed(para,true)) return;
+  int len=strlen_P(para->ptr.msg_P);
 //  noBlink();
   for (byte i=0;i<rows;i++)
   {
-    if ((para->low.i+inc>=strlen_P(para->ptr.msg_P))||(pgm_read_byte_near(para->ptr.msg_P+para->low.i+inc)=='\n'))
+    if ((para->low.i+inc>=len)||(pgm_read_byte_near(para->ptr.msg_P+para->low.i+inc)=='\n'))
     {
       ch=0;
       inc++;
     }
     else ch=pgm_read_byte_near(para->ptr.msg_P+para->low.i+inc);
-    setCursor(para->col,para->row+i);
+    place_cursor(para->col,para->row+i);
     for (byte j=0;j<columns;j++)
     {
-      if (ch==0) lcd->write(' ');
+      if (ch==0) phi_prompt_write(' ');
       else
       {
-        lcd->write(ch);
+        phi_prompt_write(ch);
         ch=pgm_read_byte_near(para->ptr.msg_P+para->low.i+(++inc));
         if ((ch=='\n')&&(j<columns-1))
         {
@@ -498,18 +916,18 @@ void long_msg_lcd_P(phi_prompt_struct* para) // Displays a long message stored i
     }
   }
 
-  if (para->option==1)
+  if ((para->option==1)&&(len>0))
   {
-    scroll_bar_v(((long)para->low.i)*100/strlen_P(para->ptr.msg_P),para->col+columns,para->row,rows);
+    scroll_bar_v(((long)para->low.i)*100/len,para->col+columns,para->row,rows);
   }
+  phi_prompt_flush();
 }
 
 
 /**
  * \details Displays a scroll bar at column/row with height and percentage.
  * If you are not very interested in the inner working of this library, this is not for you.
- * This is the only function in phi_prompt library to use custom characters.
-  * If you used custom characters and want to use this function or a long message with scroll bar, run the init again to reinitialize custom characters.
+ * Its custom characters come from phi_prompt_glyph(), so they share CGRAM with other glyphs and only the ones not loaded yet are uploaded.
  * \param percentage This goes between 0 and 99, representing the location indicator on the bar.
  * \param column This is the column location of the scroll bar's top.
  * \param row This is the row location of the scroll bar's top.
@@ -522,169 +940,394 @@ void scroll_bar_v(byte percent, byte column, byte row, byte v_height)
   mapped=(int)(v_height*2-2)*percent/100; // This is mapped position, 2 per row of bar.
   for (byte i=0;i<v_height;i++)
   {
-    setCursor(column,row+i);
+    place_cursor(column,row+i);
     if (i==(mapped+1)/2)
     {
       if (i==0)
       {
-        lcd->write((uint8_t)0);
+        phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_ch0));
       }
       else if (i==v_height-1)
       {
-        lcd->write(5);
+        phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_ch5));
       }
       else
       {
-        if (mapped+1==(mapped+1)/2*2) lcd->write(2);
-        else lcd->write(3);
+        if (mapped+1==(mapped+1)/2*2) phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_ch2));
+        else phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_ch3));
       }
     }
     else
     {
       if (i==0)
       {
-        lcd->write(1);
+        phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_ch1));
       }
       else if (i==v_height-1)
       {
-        lcd->write(4);
+        phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_ch4));
       }
       else
       {
-        lcd->write(' ');
+        phi_prompt_write(' ');
       }
     }
   }
+  phi_prompt_flush();
 }
 
 /**
- * \details Displays a static list or menu stored in SRAM or PROGMEM that could span multiple lines.
- * \param para This is the phi_prompt struct to carry information between callers and functions.
- * Option is very extensive and please refer to the documentation and option table.
- * The options are combined with OR operation with "Render list option bits" you can find in the library include file.
- * To find out what each option does exactly, run phi_prompt_big_show demo code and try the options out and write the number down.
- * If you are not interested in the inner working of this library, use text_area instead.
- * \return If further update is needed, it returns 1. The caller needs to call it again to update display, such as scrolling item.
- * If it returns 0 then no further display update is needed and the caller can stop calling it.
+ * \details Displays a horizontal bar gauge at column/row, such as a tank level or motor load. Each cell shows 0 to 5 columns of pixels, so the bar has 5 steps per cell.
+ * The cells go through the shadow like everything else, so redrawing a gauge with a new value only sends the one or two cells that changed. Call it as often as the value changes.
+ * The partial cells use custom characters from phi_prompt_glyph(). Gauges share them so any number of gauges needs at most 4 CGRAM slots.
+ * \param value This is the value to display. Values outside low to high show an empty or full bar.
+ * \param low This is the value of an empty bar.
+ * \param high This is the value of a full bar. If it is not above low the bar is always empty.
+ * \param column This is the column location of the left end of the bar.
+ * \param row This is the row location of the bar.
+ * \param width This is the length of the bar in number of characters.
  */
-byte render_list(phi_prompt_struct* para)
+void bar_gauge_h(int value, int low, int high, byte column, byte row, byte width)
 {
-  byte ret=0, _first_item, _last_item, columns=para->step.c_arr[1], rows=para->step.c_arr[0], item_per_screen=columns*rows, x1=para->col, y1=para->row, x2=para->step.c_arr[3], y2=para->step.c_arr[2]; // Which items to display.
-  char list_buffer[22];
-  long pos=millis()/500;
-
-  if (para->option&phi_prompt_center_choice) // Determine first item on whether choice is displayed centered.
+  int steps=0; // Columns of pixels to fill.
+  if (high>low) // An empty range, high equal to low, shows an empty bar rather than divide by 0.
   {
-    _first_item=para->low.i-item_per_screen/2;
-    if (_first_item>127) _first_item=0;
-    else if (para->low.i-item_per_screen/2+item_per_screen>para->high.i) _first_item=para->high.i+1-item_per_screen;
+    if (value>=high) steps=width*5;
+    else if (value>low) steps=((long)value-low)*width*5/((long)high-low); // Widen before subtracting, as -20000 to 20000 overflows an int.
   }
-  else
+  place_cursor(column,row);
+  for (byte i=0;i<width;i++,steps-=5)
   {
-    _first_item=(para->low.i/item_per_screen)*item_per_screen;
+    if (steps>=5) phi_prompt_write(0xFF); // The display's own full block.
+    else if (steps<=0) phi_prompt_write(' ');
+    else if (steps==1) phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_bar1));
+    else if (steps==2) phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_bar2));
+    else if (steps==3) phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_bar3));
+    else phi_prompt_write(phi_prompt_glyph(phi_prompt_lcd_bar4));
   }
-    
-  _last_item=_first_item+item_per_screen-1; // Determine last item based on first item, total item per screen, and total item.
-  if (_last_item>para->high.i) _last_item=para->high.i;
-  
-  for (byte i=_first_item;i<_first_item+item_per_screen;i++)
-  {
-    if (i<=_last_item) // Copy item
-    {
-      if ((para->option&phi_prompt_list_in_SRAM))
-      {
-        if ((para->option&phi_prompt_auto_scroll)&&(i==para->low.i)&&strlen(*(para->ptr.list+i))>para->width) // Determine what portion of the item to be copied. In case of no auto scrolling, only first few characters are copied till the display buffer fills. In case of auto scrolling, a certain portion of the item is copied.
-        {
-          pos=pos%(strlen(*(para->ptr.list+i))+para->width)-para->width;
-          scroll_text(*(para->ptr.list+i), list_buffer, para->width, pos);//Does the actual copy
-          ret=1; // More update is needed to scroll text.
-        }
-        else //Does the actual truncation
-        {
-          byte len=strlcpy(list_buffer,*(para->ptr.list+i), para->width+1);
-          if (len<para->width)
-          {
-            for (byte k=len;k<para->width;k++)
-            {
-              list_buffer[k]=' ';
-            }
-            list_buffer[para->width]=0;
-          }
-        }
-      }
-      else
-      {
-        if ((para->option&phi_prompt_auto_scroll)&&(i==para->low.i)&&strlen_P((char*)pgm_read_word(para->ptr.list+i))>para->width) // Determine what portion of the item to be copied. In case of no auto scrolling, only first few characters are copied till the display buffer fills. In case of auto scrolling, a certain portion of the item is copied.
-        {
-          pos=pos%(strlen_P((char*)pgm_read_word(para->ptr.list+i))+para->width)-para->width;
-          scroll_text_P((char*)pgm_read_word(para->ptr.list+i), list_buffer, para->width, pos);//Does the actual copy
-          ret=1; // More update is needed to scroll text.
-        }
-        else //Does the actual truncation
-        {
-          byte len=strlcpy_P(list_buffer,(char*)pgm_read_word(para->ptr.list+i), para->width+1);
-          if (len<para->width)
-          {
-            for (byte k=len;k<para->width;k++)
-            {
-              list_buffer[k]=' ';
-            }
-            list_buffer[para->width]=0;
-          }
-        }
-      }
-    }
-    else // Fill blank
-    {
-      byte j;
-      for (j=0;j<para->width;j++)
-      {
-        list_buffer[j]=' ';
-      }
-      list_buffer[j]=0;
-    }
-//Display item on LCD
-    setCursor(para->col+((i-_first_item)/rows)*(para->width+1), para->row+(i-_first_item)%rows);
+  phi_prompt_flush();
+}
 
-    if (para->option&phi_prompt_arrow_dot) // Determine whether to render arrow and dot. In case of yes, the buffer is shifted to the right one character.       
-    {
-      if (i<=_last_item)
-      {
-      lcd->write((i==para->low.i)?indicator:bullet);// Show ">" or a dot
-      }
-      else
-      {
-        lcd->write(' ');
-      }
-    }
-    lcd->print(list_buffer);
-  }
+/**
+ * \details Reads the variable bound to a dashboard field.
+ */
+static long field_value(phi_prompt_field *field)
+{
+  if (field->type==phi_prompt_field_long) return *(long*)field->value;
+  return *(int*)field->value;
+}
 
-  if (para->option&phi_prompt_index_list) // Determine whether to display 1234567890 index
+/**
+ * \details Renders a dashboard field showing value.
+ */
+static void render_field(phi_prompt_field *field, long value)
+{
+  char *msg=scratch_take(field->width+1);
+  if (msg==0) return;
+  phi_prompt_format_number(msg,value,field->width,field->decimals,field->option);
+  place_cursor(field->col,field->row);
+  phi_prompt_print(msg);
+  scratch_give(msg);
+}
+
+/**
+ * \details Redraws the fields of a dashboard whose variables changed since they were last drawn. Unchanged fields cost nothing, not even a cursor move.
+ * Fields are visited round-robin starting after the last field drawn. Once the update has queued budget_bytes for the display or taken budget_us, it stops and the next update continues from there, so a busy dashboard can't hold up the loop() that calls it.
+ * At least one changed field is drawn per update whatever the budget.
+ * \param board This is the dashboard. Draw its labels before the first update.
+ * \return It returns the number of changed fields still waiting to be drawn. Call it again soon if this is not 0.
+ */
+byte phi_prompt_dashboard_update(phi_prompt_dashboard *board)
+{
+  unsigned long start=micros();
+  unsigned int queued=ctx->queue_total;
+  byte drawn=0, left=0;
+  for (byte checked=0;checked<board->count;checked++)
   {
-    setCursor(x2,y2);
-    for (byte i=0;i<=para->high.i;i++)
+    phi_prompt_field *field=board->fields+board->next;
+    long value=field_value(field);
+    if ((!field->valid)||(value!=field->shown))
     {
-      if (i==para->low.i) lcd->write(indicator); // Display indicator on index
-      else lcd->write(i%10+'1');
+      if ((drawn>0)&&(((board->budget_bytes)&&((unsigned int)(ctx->queue_total-queued)>=board->budget_bytes))||((board->budget_us)&&(micros()-start>=board->budget_us)))) break; // Out of budget. Start here next time.
+      render_field(field,value);
+      phi_prompt_flush(); // Flush each field so the bytes it took count against the budget.
+      field->shown=value;
+      field->valid=true;
+      drawn++;
     }
+    board->next=(board->next+1<board->count)?board->next+1:0;
   }
-  
-  else if (para->option&phi_prompt_current_total) // Determine whether to display current/total index
-  {
-    sprintf(list_buffer,"%c%d/%d", indicator,para->low.i+1, para->high.i+1);
-    setCursor(x2,y2);
-    lcd->print(list_buffer);// Prints index
-  }
-  
-  if (para->option&phi_prompt_scroll_bar) // Determine whether to display scroll bar
+  for (byte i=0;i<board->count;i++)
   {
-    scroll_bar_v(((int)para->low.i+1)*100/(para->high.i+1),para->col+columns*(para->width+1)-1*(!(para->option&phi_prompt_arrow_dot)),para->row,rows);
+    if ((!board->fields[i].valid)||(field_value(board->fields+i)!=board->fields[i].shown)) left++;
   }
-  
+  return left;
+}
+
+/**
+ * \details Makes the next updates of a dashboard redraw every field, such as after clear() or after showing another screen.
+ */
+void phi_prompt_dashboard_invalidate(phi_prompt_dashboard *board)
+{
+  for (byte i=0;i<board->count;i++)
+  {
+    board->fields[i].valid=false;
+  }
+}
+
+/**
+ * \details Returns the highlighted item of a list, which is in low.l for lists with a callback source and in low.i for the rest.
+ */
+static long list_current(phi_prompt_struct *para)
+{
+  if (para->option&phi_prompt_list_callback) return para->low.l;
+  return para->low.i;
+}
+
+/**
+ * \details Returns the last item of a list, which is in high.l for lists with a callback source and in high.i for the rest.
+ */
+static long list_last(phi_prompt_struct *para)
+{
+  if (para->option&phi_prompt_list_callback) return para->high.l;
+  return para->high.i;
+}
+
+/**
+ * \details Highlights item of a list.
+ */
+static void set_list_current(phi_prompt_struct *para, long item)
+{
+  if (para->option&phi_prompt_list_callback) para->low.l=item;
+  else para->low.i=item;
+}
+
+/**
+ * \details Fetches the items on screen of a list with a callback source into its cache, unless they are there already.
+ * \param first This is the first item on screen.
+ * \param count This is the number of items on screen.
+ */
+static void fill_source_cache(phi_prompt_struct *para, long first, byte count)
+{
+  phi_prompt_list_source *source=para->ptr.source;
+  if ((source->first==first)&&(source->count>=count)) return;
+  for (byte slot=0;slot<count;slot++)
+  {
+    source->lengths[slot]=source->fetch(first+slot,0,source->cache+slot*para->width,para->width);
+  }
+  source->first=first;
+  source->count=count;
+}
+
+/**
+ * \details Copies an item of a list with a callback source into dst, padded to the width of the list.
+ * The item comes from the cache, unless it is the highlighted item scrolling automatically. Only the visible part of that item is fetched.
+ * \param item This is the item.
+ * \param slot This is where the item is on screen, 0 for the first item on screen.
+ * \param pos This is the auto scroll clock.
+ * \return It returns 1 if the item scrolls and needs more updates.
+ */
+static byte source_item(phi_prompt_struct *para, long item, byte slot, char *dst, long pos)
+{
+  phi_prompt_list_source *source=para->ptr.source;
+  byte width=para->width;
+  int len=source->lengths[slot];
+  memset(dst,' ',width);
+  dst[width]=0;
+  if ((para->option&phi_prompt_auto_scroll)&&(item==para->low.l)&&(len>width))
+  {
+    pos=pos%(len+width)-width;
+    byte start=(pos<0)?-pos:0; // Where the visible part of the item starts in dst.
+    int offset=(pos<0)?0:pos, n=len-offset;
+    if (n>width-start) n=width-start;
+    if (n>0) source->fetch(item,offset,dst+start,n);
+    return 1;
+  }
+  memcpy(dst,source->cache+slot*width,(len<width)?len:width);
+  return 0;
+}
+
+/**
+ * \details Works out which items of a list are on screen.
+ * \param first This returns the first item on screen.
+ * \param last This returns the last item on screen, which is less than first plus items per screen at the end of the list.
+ */
+static void list_window(phi_prompt_struct *para, long *first, long *last)
+{
+  byte item_per_screen=para->step.c_arr[1]*para->step.c_arr[0];
+  long current=list_current(para), last_item=list_last(para);
+  if (para->option&phi_prompt_center_choice) // Determine first item on whether choice is displayed centered.
+  {
+    *first=current-item_per_screen/2;
+    if (*first+item_per_screen>last_item) *first=last_item+1-item_per_screen;
+    if (*first<0) *first=0;
+  }
+  else
+  {
+    *first=(current/item_per_screen)*item_per_screen;
+  }
+    
+  *last=*first+item_per_screen-1; // Determine last item based on first item, total item per screen, and total item.
+  if (*last>last_item) *last=last_item;
+}
+
+/**
+ * \details Renders item i of a list at its place on screen, with its arrow or dot. Items past the last item render blank.
+ * \param _first_item This is the first item on screen.
+ * \param _last_item This is the last item on screen.
+ * \param pos This is the auto scroll clock.
+ * \return It returns 1 if the item scrolls and needs more updates.
+ */
+static byte render_list_item(phi_prompt_struct *para, long i, long _first_item, long _last_item, long pos)
+{
+  byte ret=0, rows=para->step.c_arr[0];
+  long current=list_current(para);
+  char *list_buffer=scratch_take(para->width+1);
+  if (list_buffer==0) return 0;
+  if ((i<=_last_item)&&(para->option&phi_prompt_list_callback)) ret=source_item(para,i,i-_first_item,list_buffer,pos);
+  else if (i<=_last_item) // Copy item
+  {
+    boolean in_progmem=!(para->option&phi_prompt_list_in_SRAM);
+    const char *text;
+    int len=-1; // Length of the item, -1 until it is known.
+    if (!in_progmem) text=*(para->ptr.list+i);
+    else if (para->option&phi_prompt_list_items) // The descriptor carries the length so the item is never scanned.
+    {
+      phi_prompt_list_item item;
+      memcpy_P(&item,para->ptr.items+i,sizeof(item));
+      text=item.text;
+      len=item.len;
+    }
+    else text=(PGM_P)pgm_read_word(para->ptr.list+i);
+
+    if ((para->option&phi_prompt_auto_scroll)&&(i==current)&&(len<0)) len=in_progmem?strlen_P(text):strlen(text);
+    if ((para->option&phi_prompt_auto_scroll)&&(i==current)&&(len>para->width)) // Determine what portion of the item to be copied. In case of no auto scrolling, only first few characters are copied till the display buffer fills. In case of auto scrolling, a certain portion of the item is copied.
+    {
+      pos=pos%(len+para->width)-para->width;
+      scroll_window(text, len, in_progmem, list_buffer, para->width, pos);//Does the actual copy
+      ret=1; // More update is needed to scroll text.
+    }
+    else //Does the actual truncation
+    {
+      byte n;
+      if (len>=0) // Copy only what fits instead of letting strlcpy scan the rest of the item.
+      {
+        n=(len<para->width)?len:para->width;
+        if (in_progmem) memcpy_P(list_buffer,text,n);
+        else memcpy(list_buffer,text,n);
+      }
+      else
+      {
+        size_t full=in_progmem?strlcpy_P(list_buffer,text,para->width+1):strlcpy(list_buffer,text,para->width+1);
+        n=(full<para->width)?full:para->width;
+      }
+      for (byte k=n;k<para->width;k++)
+      {
+        list_buffer[k]=' ';
+      }
+      list_buffer[para->width]=0;
+    }
+  }
+  else // Fill blank
+  {
+    byte j;
+    for (j=0;j<para->width;j++)
+    {
+      list_buffer[j]=' ';
+    }
+    list_buffer[j]=0;
+  }
+//Display item on LCD
+  place_cursor(para->col+((i-_first_item)/rows)*(para->width+1), para->row+(i-_first_item)%rows);
+
+  if (para->option&phi_prompt_arrow_dot) // Determine whether to render arrow and dot. In case of yes, the buffer is shifted to the right one character.       
+  {
+    if (i<=_last_item)
+    {
+    phi_prompt_write((i==current)?ctx->indicator:ctx->bullet);// Show ">" or a dot
+    }
+    else
+    {
+      phi_prompt_write(' ');
+    }
+  }
+  phi_prompt_print(list_buffer);
+  scratch_give(list_buffer);
+  return ret;
+}
+
+/**
+ * \details Renders only the highlighted item of a list that auto scrolls, for when nothing but its scroll position has changed.
+ * \return It returns 1 if the item still needs updates to scroll.
+ */
+static byte render_scrolling_item(phi_prompt_struct *para)
+{
+  byte rows=para->step.c_arr[0];
+  long _first_item, _last_item, current=list_current(para);
+  list_window(para,&_first_item,&_last_item);
+  if (para->option&phi_prompt_list_callback) fill_source_cache(para,_first_item,_last_item-_first_item+1);
+  byte ret=render_list_item(para,current,_first_item,_last_item,millis()/phi_prompt_scroll_time);
+  if (para->option&phi_prompt_flash_cursor) place_cursor(para->col+((current-_first_item)/rows)*(para->width+1), para->row+(current-_first_item)%rows); // Put the flashing cursor back on the item.
+  phi_prompt_flush();
+  return ret;
+}
+
+/**
+ * \details Displays a static list or menu stored in SRAM or PROGMEM that could span multiple lines.
+ * With the phi_prompt_list_callback option the items come from a phi_prompt_list_source instead, so the list can have as many items as a long counts.
+ * \param para This is the phi_prompt struct to carry information between callers and functions.
+ * Option is very extensive and please refer to the documentation and option table.
+ * The options are combined with OR operation with "Render list option bits" you can find in the library include file.
+ * To find out what each option does exactly, run phi_prompt_big_show demo code and try the options out and write the number down.
+ * If you are not interested in the inner working of this library, use text_area instead.
+ * \return If further update is needed, it returns 1. The caller needs to call it again to update display, such as scrolling item.
+ * If it returns 0 then no further display update is needed and the caller can stop calling it.
+ */
+byte render_list(phi_prompt_struct* para)
+{
+  byte ret=0, columns=para->step.c_arr[1], rows=para->step.c_arr[0], item_per_screen=columns*rows, x2=para->step.c_arr[3], y2=para->step.c_arr[2];
+  long _first_item, _last_item, current=list_current(para), last=list_last(para); // Which items to display.
+  long pos=millis()/phi_prompt_scroll_time;
+
+  list_window(para,&_first_item,&_last_item);
+  if (para->option&phi_prompt_list_callback) fill_source_cache(para,_first_item,_last_item-_first_item+1);
+  
+  for (long i=_first_item;i<_first_item+item_per_screen;i++)
+  {
+    ret|=render_list_item(para,i,_first_item,_last_item,pos);
+  }
+
+  if (para->option&phi_prompt_index_list) // Determine whether to display 1234567890 index
+  {
+    place_cursor(x2,y2);
+    for (long i=0;i<=last;i++)
+    {
+      if (i==current) phi_prompt_write(ctx->indicator); // Display indicator on index
+      else phi_prompt_write(i%10+'1');
+    }
+  }
+  
+  else if (para->option&phi_prompt_current_total) // Determine whether to display current/total index
+  {
+    char *list_buffer=scratch_take(2*phi_prompt_format_digits+2);
+    if (list_buffer!=0)
+    {
+      list_buffer[0]=ctx->indicator;
+      phi_prompt_format_index(list_buffer+1,current+1,last+1);
+      place_cursor(x2,y2);
+      phi_prompt_print(list_buffer);// Prints index
+      scratch_give(list_buffer);
+    }
+  }
+  
+  if (para->option&phi_prompt_scroll_bar) // Determine whether to display scroll bar
+  {
+    scroll_bar_v((current+1)*100/(last+1),para->col+columns*(para->width+1)-1*(!(para->option&phi_prompt_arrow_dot)),para->row,rows);
+  }
+  
   if (para->option&phi_prompt_flash_cursor) // Determine whether to display flashing cursor
   {
-    setCursor(para->col+((para->low.i-_first_item)/rows)*(para->width+1), para->row+(para->low.i-_first_item)%rows);
+    place_cursor(para->col+((current-_first_item)/rows)*(para->width+1), para->row+(current-_first_item)%rows);
     blink();
   }
   else noBlink();
@@ -693,107 +1336,816 @@ byte render_list(phi_prompt_struct* para)
   {
     
   }
+  phi_prompt_flush(); // Only the cells that differ from the last render go out.
   return ret;  
 }
 //------------------------------------------------------------------------------
-void clear(){
-  lcd->write(0xFE);  //command flag 
-  lcd->write(0x01);  //clear command.
-  delay(50);
+/**
+ * \details Sends queued bytes to the display as long as the display is ready for them. It never waits: a byte that follows a command still settling stays queued for the next call.
+ * wait_on_escape() calls this while it polls the keypads. Call it from your loop() too if you render without waiting on keys.
+ * Call while(phi_prompt_service()); before writing to the display directly with lcd.print() so your text does not overtake queued output.
+ * \return It returns the number of bytes still queued.
+ */
+int phi_prompt_service()
+{
+  while (ctx->queue_count)
+  {
+    if ((long)(micros()-ctx->queue_ready)<0) break; // The last command is still settling.
+    if (ctx->settle_pending) // A buffered driver may not have sent the command yet, so its settle time starts once the driver is idle.
+    {
+      if (!ctx->lcd->idle()) break;
+      ctx->queue_ready=micros()+ctx->settle_pending*1000UL;
+      count_stat(settle_ms,ctx->settle_pending);
+      ctx->settle_pending=0;
+      continue;
+    }
+    byte flags=ctx->queue[ctx->queue_tail].flags, room=ctx->lcd->room();
+    if (flags&phi_prompt_queued_command)
+    {
+      if (room<2) break; // Wait for room rather than have the driver wait.
+      ctx->lcd->command(ctx->queue[ctx->queue_tail].value);
+      count_stat(bytes,1);
+      count_stat(commands,1);
+#ifdef phi_prompt_stats
+      if (ctx->trace) ctx->trace(ctx->queue[ctx->queue_tail].value,flags);
+#endif
+      ctx->queue_tail=(ctx->queue_tail+1)%phi_prompt_queue_size;
+      ctx->queue_count--;
+      ctx->settle_pending=flags&phi_prompt_queued_settle;
+    }
+    else // Hand the run of characters up to the next command to the driver in one go so it can burst them.
+    {
+      byte burst[phi_prompt_burst_size], n=0;
+      if (room==0) break;
+      while (ctx->queue_count&&(n<phi_prompt_burst_size)&&(n<room)&&!(ctx->queue[ctx->queue_tail].flags&phi_prompt_queued_command))
+      {
+        burst[n++]=ctx->queue[ctx->queue_tail].value;
+        ctx->queue_tail=(ctx->queue_tail+1)%phi_prompt_queue_size;
+        ctx->queue_count--;
+      }
+      ctx->lcd->write(burst,n);
+      count_stat(bytes,n);
+#ifdef phi_prompt_stats
+      if (ctx->trace) for (byte i=0;i<n;i++) ctx->trace(burst[i],0);
+#endif
+    }
+  }
+  return ctx->queue_count;
 }
 
-void setCursor(int posNum, int lineNum){
-  int delayTime = 50;
-  int lcdPosition = 0;  // initialize lcdPosition 
-  // posNum has to be within 1 to 20,
-  // lineNum has to be within 1 to 4
-    if (posNum < 21) {
-      if (lineNum==0){
-        lcdPosition = 128;
-      } else if (lineNum==1){
-        lcdPosition = 192;
-      } else if (lineNum==2){
-        lcdPosition = 148;
-      } else if (lineNum==3){
-        lcdPosition = 212;
-    }
-  } 
-    if (lcdPosition > 0){
-    // add to start of linepos to get the position 
-      lcdPosition = lcdPosition + posNum;
-      lcd->write(0xFE);  //command flag
-      delay(delayTime);
-      lcd->write(lcdPosition);   //position
-      delay(delayTime);
+/**
+ * \details Sends queued bytes to every display initialized with init_phi_prompt(), one context after another, as far as each display is ready for them. It never waits.
+ * \return It returns the number of bytes still queued for all displays.
+ */
+int phi_prompt_service_all()
+{
+  int queued=0;
+  phi_prompt_context *caller=ctx;
+  for (ctx=contexts;ctx!=0;ctx=ctx->next) queued+=phi_prompt_service();
+  ctx=caller;
+  return queued;
+}
+
+#ifdef phi_prompt_stats
+/**
+ * \details Returns the counters of the bound context, which keep counting until phi_prompt_reset_stats() or the next init_phi_prompt().
+ */
+phi_prompt_counters *phi_prompt_read_stats()
+{
+  return &ctx->stats;
+}
+
+void phi_prompt_reset_stats()
+{
+  memset(&ctx->stats,0,sizeof(ctx->stats));
+  ctx->stats_mark=0;
+}
+
+/**
+ * \details Prints the counters of the bound context as name and value, one per line. Renders are listed by widget id for the widgets that rendered. The last line is the scratch arena high-water mark and size.
+ * \param p This is where to print, such as &Serial.
+ */
+void phi_prompt_dump_stats(Print *p)
+{
+  phi_prompt_counters *c=&ctx->stats;
+  p->print("bytes ");
+  p->println(c->bytes);
+  p->print("commands ");
+  p->println(c->commands);
+  p->print("setCursor ");
+  p->println((unsigned long)c->set_cursor);
+  p->print("clear ");
+  p->println((unsigned long)c->clears);
+  p->print("createChar ");
+  p->println((unsigned long)c->create_chars);
+  p->print("settle ms ");
+  p->println(c->settle_ms);
+  for (byte i=0;i<=phi_prompt_widgets;i++)
+  {
+    if (c->renders[i]==0) continue;
+    p->print("renders widget ");
+    p->print((unsigned long)i);
+    p->print(' ');
+    p->println((unsigned long)c->renders[i]);
+  }
+  p->print("idle us ");
+  p->println(c->idle_us);
+  p->print("busy us ");
+  p->println(c->busy_us);
+  p->print("scratch ");
+  p->print((unsigned long)ctx->scratch_peak);
+  p->print(" of ");
+  p->println((unsigned long)ctx->scratch_size);
+}
+
+/**
+ * \details Sets a function the bound context calls with every byte it hands to the display driver, to profile renderers such as render_list or long_msg_lcd in the field.
+ * The hook runs inside phi_prompt_service(), so keep it short, such as storing the byte with micros() in a buffer.
+ * \param hook This gets the byte and phi_prompt_queued_command plus the settle time in ms for a command, or 0 for a character. 0 turns tracing off.
+ */
+void phi_prompt_set_trace(void (*hook)(byte value, byte flags))
+{
+  ctx->trace=hook;
+}
+
+/**
+ * \details Trace hook of phi_prompt_record(). Each record is the flags, the byte and the microseconds since the last record, 7 bits at a time with the top bit set on all but the last.
+ */
+static void record_byte(byte value, byte flags)
+{
+  unsigned long now=micros(), delta=now-ctx->record_time;
+  ctx->record_time=now;
+  ctx->record_out->write(flags);
+  ctx->record_out->write(value);
+  while (delta>=0x80)
+  {
+    ctx->record_out->write((byte)(delta|0x80));
+    delta>>=7;
+  }
+  ctx->record_out->write((byte)delta);
+}
+
+/**
+ * \details Records everything the bound context sends to its display and every key press it takes, with when it happened, as a compact binary trace.
+ * extras/host/replay plays the keys of a trace back through the library on a PC and compares the display output with the trace, so you can capture real sessions and check rendering changes against them.
+ * The trace starts with "PHT1", the display width and height, micros() when recording started in 4 bytes low byte first, the length of the session name and the name. Records follow as written by the trace hook, 3 bytes for a byte sent within 128us of the last and 4 within 16ms.
+ * Recording takes over the trace hook set with phi_prompt_set_trace() and puts it back when it stops.
+ * \param out This is where the trace goes, such as an SD file or &Serial. 0 stops recording.
+ * \param session This names the session, so the replay tool knows which of its sessions the keys drive.
+ */
+void phi_prompt_record(Print *out, const char *session)
+{
+  if (ctx->trace!=record_byte) ctx->record_previous=ctx->trace; // Starting again while recording keeps the hook from before.
+  ctx->record_out=out;
+  if (out==0)
+  {
+    ctx->trace=ctx->record_previous;
+    ctx->record_previous=0;
+    return;
+  }
+  byte len=strlen(session);
+  out->write((const byte *)"PHT1",4);
+  out->write((byte)ctx->lcd_w);
+  out->write((byte)ctx->lcd_h);
+  ctx->record_time=micros();
+  for (byte i=0;i<4;i++) out->write((byte)(ctx->record_time>>(i*8))); // Lets a replay start at the same time, since auto scrolling follows millis().
+  out->write(len);
+  out->write((const byte *)session,len);
+  ctx->trace=record_byte;
+}
+#endif
+
+/**
+ * \details Queues one byte for the display. If the queue is full it sends bytes until there is room, which is the only time output waits on the display.
+ * \param value This is the byte.
+ * \param flags This is phi_prompt_queued_command for a command byte, plus the settle time in ms the display needs after it.
+ */
+static void queue_put(byte value, byte flags)
+{
+  while (ctx->queue_count>=phi_prompt_queue_size)
+  {
+    phi_prompt_service();
+#ifndef phi_prompt_keys_in_isr
+    phi_prompt_scan_keys(); // Don't lose key presses during a long display update.
+#endif
+  }
+  ctx->queue[ctx->queue_head].value=value;
+  ctx->queue[ctx->queue_head].flags=flags;
+  ctx->queue_head=(ctx->queue_head+1)%phi_prompt_queue_size;
+  ctx->queue_count++;
+  ctx->queue_total++;
+}
+
+static void queue_command(byte cmd, byte settle)
+{
+  queue_put(cmd,phi_prompt_queued_command|settle);
+}
+
+static void queue_data(byte ch)
+{
+  queue_put(ch,0);
+}
+
+/**
+ * \details Returns the DDRAM address of a cell. Rows 2 and 3 of a 4-row display continue rows 0 and 1, so they start lcd_w later.
+ * \return It returns 255 for a cell that has no address.
+ */
+static byte ddram_address(int col, int row)
+{
+  if ((col<0)||(col>=0x28)||(row<0)||(row>3)) return 255;
+  byte address=(row&1)?0x40:0x00;
+  if (row&2) address+=ctx->lcd_w;
+  return address+col;
+}
+
+/**
+ * \details Moves hw_address on the way the display moves its address counter after a character: from the end of the first line to the second and back.
+ */
+static void advance_address()
+{
+  if (ctx->hw_address==255) return;
+  ctx->hw_address++;
+  if (ctx->hw_address==0x28) ctx->hw_address=0x40;
+  else if (ctx->hw_address==0x68) ctx->hw_address=0x00;
+}
+
+/**
+ * \details Sends the serial LCD command that moves the display's own cursor. Only setCursor(), place_cursor() and phi_prompt_flush() call it.
+ * \param posNum This is the column, starting from 0.
+ * \param lineNum This is the row, starting from 0.
+ */
+static void send_cursor(int posNum, int lineNum){
+  byte address=ddram_address(posNum,lineNum);
+  if (address==255)
+  {
+    ctx->hw_address=255;
+    return;
+  }
+  if (address==ctx->hw_address) return; // The display is already there, such as after writing the cell before.
+  queue_command(0x80|address,phi_prompt_command_settle);
+  ctx->hw_address=address;
+}
+
+/**
+ * \details Sends a display on/off control command (cursor and blink bits) unless the display is already in that state.
+ * \param cmd This is the command, 0x0C for no cursor, 0x0D for blinking block, 0x0E for underline cursor.
+ */
+static void send_display_control(byte cmd)
+{
+  if (ctx->shadow&&(cmd==ctx->display_control)) return;
+  queue_command(cmd,phi_prompt_command_settle);
+  ctx->display_control=cmd;
+}
+
+/**
+ * \details Writes one character at the current cursor location set by setCursor() or a renderer and moves the cursor to the right.
+ * The character goes into the shadow of the display and only reaches the display on the next phi_prompt_flush() if it changes what is shown.
+ * Characters that fall outside of the display are dropped.
+ * \param ch This is the character to write.
+ */
+void phi_prompt_write(byte ch)
+{
+  if (ctx->shadow==0)
+  {
+    queue_data(ch);
+    advance_address();
+    return;
+  }
+  if ((ctx->cursor_col<ctx->lcd_w)&&(ctx->cursor_row<ctx->lcd_h))
+  {
+    int i=ctx->cursor_row*ctx->lcd_w+ctx->cursor_col;
+    byte mask=1<<(i&7);
+    if ((ctx->shadow_unknown[i>>3]&mask)||(ctx->shadow[i]!=(char)ch))
+    {
+      ctx->shadow[i]=ch;
+      ctx->shadow_dirty[i>>3]|=mask;
+      ctx->shadow_unknown[i>>3]&=~mask;
     }
   }
+  if (ctx->cursor_col<255) ctx->cursor_col++;
+}
+
+/**
+ * \details Writes a zero-terminated string at the current cursor location. See phi_prompt_write().
+ * \param msg This is the string to write.
+ */
+void phi_prompt_print(const char * msg)
+{
+  while (*msg) phi_prompt_write(*msg++);
+}
+
+/**
+ * \details Sends every changed cell of the shadow to the display, row by row. Consecutive changed cells are sent without moving the cursor in between.
+ * If the cursor is shown, it is returned to the location last set by setCursor() or a renderer afterwards.
+ * Renderers call this when they are done and wait_on_escape() calls it before sensing keys, so you only need to call it after writing with phi_prompt_write() yourself.
+ */
+void phi_prompt_flush()
+{
+  if (ctx->shadow==0) return;
+#ifdef phi_prompt_stats
+  unsigned int queued=ctx->queue_total;
+#endif
+  for (byte k=0;k<ctx->lcd_h;k++)
+  {
+    static const byte four_row_order[4]={0,2,1,3}; // A 4-line HD44780 wraps from row 0 into row 2 and from row 1 into row 3.
+    byte r=(ctx->lcd_h==4)?four_row_order[k]:k; // Visit the rows in the order of their addresses so writes run on from one row into the next. Other heights go top to bottom.
+    for (byte c=0;c<ctx->lcd_w;c++)
+    {
+      int i=r*ctx->lcd_w+c;
+      if (ctx->shadow_dirty[i>>3]==0) // Skip 8 clean cells at a time.
+      {
+        c+=7-(i&7);
+        continue;
+      }
+      if (!(ctx->shadow_dirty[i>>3]&(1<<(i&7)))) continue;
+      byte gap=1;
+      while ((gap<=phi_prompt_gap_fill)&&(gap<=c)&&(ddram_address(c-gap,r)!=ctx->hw_address)) gap++;
+      if ((gap<=phi_prompt_gap_fill)&&(gap<=c)) // The display is gap cells short of this one. Sending them again costs no more than a cursor move.
+      {
+        for (int j=i-gap;j<i;j++)
+        {
+          if (ctx->shadow_unknown[j>>3]&(1<<(j&7))) gap=0; // Don't overwrite cells written around the shadow.
+        }
+        for (;gap>0;gap--)
+        {
+          queue_data(ctx->shadow[i-gap]);
+          advance_address();
+        }
+      }
+      send_cursor(c,r);
+      queue_data(ctx->shadow[i]);
+      advance_address();
+      ctx->shadow_dirty[i>>3]&=~(1<<(i&7));
+    }
+  }
+  if (ctx->display_control&0x03) send_cursor(ctx->cursor_col,ctx->cursor_row);
+#ifdef phi_prompt_stats
+  if (ctx->queue_total!=queued) ctx->stats.renders[ctx->widget]++;
+#endif
+  phi_prompt_service(); // Get the first bytes going without waiting for the next key poll.
+}
+
+/**
+ * \details Forgets what the display shows. Call this after writing to the display without going through phi_prompt, such as with lcd.print().
+ * The next write to any cell is then sent even if the shadow already has the same character.
+ */
+void phi_prompt_invalidate()
+{
+  ctx->hw_address=255;
+  ctx->display_control=0;
+  if (ctx->shadow==0) return;
+  memset(ctx->shadow_unknown,0xFF,(ctx->shadow_cells+7)/8);
+}
+
+void clear(){
+  count_stat(clears,1);
+  queue_command(0x01,phi_prompt_clear_settle);  //clear command.
+  ctx->cursor_col=ctx->cursor_row=0;
+  ctx->hw_address=0;
+  if (ctx->shadow)
+  {
+    memset(ctx->shadow,' ',ctx->lcd_w*ctx->lcd_h); // The display is blank now and so is the shadow. Pending changes are void.
+    memset(ctx->shadow_dirty,0,(ctx->lcd_w*ctx->lcd_h+7)/8);
+    memset(ctx->shadow_unknown,0,(ctx->lcd_w*ctx->lcd_h+7)/8);
+  }
+}
+
+/**
+ * \details Sets where the next character goes for the renderers. With the shadow in place this does not talk to the display.
+ * The display's cursor follows on the next phi_prompt_flush() if it is shown. The renderers use this instead of setCursor() so moving about the screen costs nothing.
+ */
+static void place_cursor(int posNum, int lineNum){
+  count_stat(set_cursor,1);
+  if (ctx->shadow==0)
+  {
+    send_cursor(posNum,lineNum);
+    return;
+  }
+  ctx->cursor_col=posNum;
+  ctx->cursor_row=lineNum;
+}
+
+/**
+ * \details Sends everything queued for the display and waits out the settle time of the last command, so the caller may write to the display directly.
+ */
+static void drain_output()
+{
+  while (phi_prompt_service()) {}
+  if (ctx->settle_pending)
+  {
+    while (!ctx->lcd->idle()) {}
+    ctx->queue_ready=micros()+ctx->settle_pending*1000UL;
+    count_stat(settle_ms,ctx->settle_pending);
+    ctx->settle_pending=0;
+  }
+  while ((long)(micros()-ctx->queue_ready)<0) {}
+}
+
+/**
+ * \details Moves the display's cursor, as sketches expect before writing with lcd.print(). Changes waiting in the shadow are flushed first and the cursor command has gone out when this returns.
+ * phi_prompt_write(), phi_prompt_print() and msg_lcd() also write from here. Call phi_prompt_invalidate() after writing around the library so the shadow learns the display changed.
+ */
+void setCursor(int posNum, int lineNum){
+  count_stat(set_cursor,1);
+  ctx->cursor_col=posNum;
+  ctx->cursor_row=lineNum;
+  phi_prompt_flush();
+  send_cursor(posNum,lineNum);
+  drain_output();
+  ctx->hw_address=255; // Whatever the caller writes next moves the address counter behind the library's back.
+}
   
 void blink(){
-  int delayTime = 50;
-  lcd->write(0xFE); 
-  lcd->write(0x0D); 
-  delay(delayTime);
+  send_display_control(0x0D);
+  phi_prompt_flush();
+}
+
+void noBlink(){
+  send_display_control(0x0C);
+}
+
+void cursor(){
+  send_display_control(0x0E);
+  phi_prompt_flush();
+}
+
+void noCursor(){
+  send_display_control(0x0C);
+}
+
+// Allows us to fill the first 8 CGRAM locations
+// with custom characters
+// phi_prompt_glyph() won't use a location filled this way until the next init.
+void createChar(uint8_t location, uint8_t charmap[]) {
+  location &= 0x7; // we only have 8 locations 0-7
+  count_stat(create_chars,1);
+  queue_command(64+location*8,0);  //set CGRAM address command.
+  for (int i=0; i<8; i++) {
+    queue_data(charmap[i]); 
+    }
+  ctx->hw_address=255; // The address counter now points into CGRAM.
+  ctx->glyph_ids[location]=0;
+  ctx->glyph_pinned|=1<<location;
+  }
+
+/**
+ * \details Tells whether any cell of the shadow shows a CGRAM slot, including cells still waiting to be sent. Without the shadow nothing is known to be on screen.
+ * Cells phi_prompt_invalidate() marked unknown don't count: the shadow doesn't know what they show.
+ */
+static boolean glyph_on_screen(byte slot)
+{
+  if (ctx->shadow==0) return false;
+  for (int i=0;i<ctx->lcd_w*ctx->lcd_h;i++)
+  {
+    if (ctx->shadow_unknown[i>>3]&(1<<(i&7))) continue;
+    if ((ctx->shadow[i]&0xF7)==slot) return true; // Codes 8-15 show slots 0-7 too.
+  }
+  return false;
+}
+
+/**
+ * \details Counts the pixels that differ between a glyph and 8 rows of pixels. A glyph address of 0 stands for a blank cell.
+ */
+static byte glyph_distance(PGM_P glyph, const byte rows[8])
+{
+  byte d=0;
+  for (byte r=0;r<8;r++)
+  {
+    byte bits=(rows[r]^(glyph?pgm_read_byte_near(glyph+r):0))&0x1F;
+    for (;bits;bits&=bits-1) d++;
+  }
+  return d;
+}
+
+/**
+ * \details Finds the character that looks most like the glyph in a slot about to be evicted: another glyph in CGRAM, a space or the full block 0xFF.
+ * \return It returns the character code to show instead.
+ */
+static byte glyph_substitute(byte evicted)
+{
+  byte rows[8], best=' ', best_distance;
+  for (byte r=0;r<8;r++) rows[r]=ctx->glyph_ids[evicted]?pgm_read_byte_near(ctx->glyph_ids[evicted]+r):0;
+  best_distance=glyph_distance(0,rows);
+  byte distance=40-best_distance; // The full block lights every pixel.
+  if (distance<best_distance)
+  {
+    best=0xFF;
+    best_distance=distance;
+  }
+  for (byte slot=0;slot<8;slot++)
+  {
+    if ((slot==evicted)||(ctx->glyph_ids[slot]==0)) continue;
+    distance=glyph_distance(ctx->glyph_ids[slot],rows);
+    if (distance<best_distance)
+    {
+      best=slot;
+      best_distance=distance;
+    }
+  }
+  return best;
+}
+
+/**
+ * \details Picks the CGRAM slot to load a new glyph into: the least recently used slot that is not on screen, or failing that the least recently used slot.
+ * Cells showing that slot are changed to the closest character still available and flushed, so they never show the new glyph by mistake.
+ * \return It returns 8 if createChar() has taken every slot.
+ */
+static byte evict_glyph()
+{
+  byte fallback=8;
+  for (byte i=0;i<8;i++)
+  {
+    byte slot=ctx->glyph_lru[i];
+    if (ctx->glyph_pinned&(1<<slot)) continue;
+    if (!glyph_on_screen(slot)) return slot;
+    if (fallback==8) fallback=slot;
+  }
+  if (fallback==8) return 8;
+  byte substitute=glyph_substitute(fallback);
+  for (int i=0;i<ctx->lcd_w*ctx->lcd_h;i++)
+  {
+    if (ctx->shadow_unknown[i>>3]&(1<<(i&7))) continue; // Leave what the sketch wrote around the shadow alone.
+    if ((ctx->shadow[i]&0xF7)==fallback)
+    {
+      ctx->shadow[i]=substitute;
+      ctx->shadow_dirty[i>>3]|=1<<(i&7);
+    }
+  }
+  phi_prompt_flush(); // The cells must show the substitute before the slot is loaded with the new glyph.
+  return fallback;
+}
+
+/**
+ * \details Gets a custom character ready to display and returns the character code to write for it, such as phi_prompt_write(phi_prompt_glyph(my_glyph)).
+ * The 8 CGRAM slots hold the most recently used glyphs. A glyph is uploaded only if it is not in a slot already.
+ * \param glyph This is the glyph, 8 rows of 5 pixels in PROGMEM. The glyph is known by this address so keep one copy of each glyph.
+ * \return It returns the character code of the slot holding the glyph, or a space if createChar() has taken every slot.
+ */
+byte phi_prompt_glyph(PGM_P glyph)
+{
+  byte slot=8;
+  for (byte i=0;i<8;i++)
+  {
+    if (ctx->glyph_ids[i]==glyph) slot=i;
+  }
+  if (slot==8)
+  {
+    slot=evict_glyph();
+    if (slot==8) return ' ';
+    byte charmap[8];
+    memcpy_P(charmap,glyph,8);
+    queue_command(64+slot*8,0);  //set CGRAM address command.
+    for (byte i=0;i<8;i++) queue_data(charmap[i]);
+    count_stat(create_chars,1);
+    ctx->hw_address=255; // The address counter now points into CGRAM.
+    ctx->glyph_ids[slot]=glyph;
+  }
+  byte i=0;
+  while (ctx->glyph_lru[i]!=slot) i++;
+  for (;i<7;i++) ctx->glyph_lru[i]=ctx->glyph_lru[i+1]; // Move the slot to the most recently used end.
+  ctx->glyph_lru[7]=slot;
+  return slot;
+}
+
+//Interactions
+
+/**
+ * \details Polls every keypad once and queues any key press with the time it was sensed. Keypads debounce in getKey() so this needs to be called regularly.
+ * With phi_prompt_timer2_keys defined, Timer2 calls this phi_prompt_key_scan_rate times a second, so key presses made during a slow display update are queued too.
+ * Without it, wait_on_escape() calls this while it waits and the display queue calls it while it waits for room.
+ * Call it from your own timer interrupt if you have one. Don't call it from both an interrupt and your loop().
+ * From an interrupt, including with phi_prompt_timer2_keys, only keypads that read pins directly work. I2C and serial keypads talk on a bus in getKey(), which needs interrupts on, so scan those from loop().
+ */
+void phi_prompt_scan_keys()
+{
+  for (phi_prompt_context *c=contexts;c!=0;c=c->next) // Every context, so the keys of a user interface that isn't bound are not lost.
+  {
+    byte i=0;
+    while(c->mbi_ptr[i])
+    {
+      byte key=c->mbi_ptr[i]->getKey();
+      if (key!=NO_KEY)
+      {
+        byte next=(c->key_head+1)%phi_prompt_key_queue_size;
+        if (next!=c->key_tail) // A full queue drops the new key press rather than the ones the user made first.
+        {
+          c->key_events[c->key_head].key=key;
+          c->key_events[c->key_head].time=millis();
+          c->key_events[c->key_head].held=(c->mbi_ptr[i]->get_status()==buttons_held); // Fast taps come as separate presses. Only the keypad knows the key never went up.
+          c->key_head=next;
+        }
+      }
+      i++;
+    }
+  }
+}
+
+#ifdef phi_prompt_keys_in_isr
+ISR(TIMER2_COMPA_vect)
+{
+  phi_prompt_scan_keys();
+}
+
+/**
+ * \details Sets Timer2 to clear on compare match and interrupt phi_prompt_key_scan_rate times a second.
+ */
+static void start_key_timer()
+{
+  TCCR2A=(1<<WGM21); // CTC mode
+  TCCR2B=(1<<CS22)|(1<<CS21)|(1<<CS20); // Prescaler 1024
+  OCR2A=F_CPU/1024/phi_prompt_key_scan_rate-1;
+  TIMSK2|=(1<<OCIE2A);
+}
+#endif
+
+/**
+ * \details Takes the oldest key press off the key queue.
+ * \return Returns the key as the keypad reported it, or NO_KEY if the queue is empty.
+ */
+static byte next_key_event()
+{
+  if (ctx->key_tail==ctx->key_head) return NO_KEY;
+  byte key=ctx->key_events[ctx->key_tail].key;
+  boolean held=ctx->key_events[ctx->key_tail].held;
+  ctx->key_tail=(ctx->key_tail+1)%phi_prompt_key_queue_size;
+  if ((key==ctx->held_key)&&held) // Another repeat of a key being held
+  {
+    if (ctx->key_repeats<255) ctx->key_repeats++;
+  }
+  else ctx->key_repeats=0;
+  ctx->held_key=key;
+  return key;
+}
+
+/**
+ * \details Tells how many times further than one step a key being held should move a value: 1 at first, 10 after phi_prompt_accel_repeats repeats and 100 after twice as many.
+ * \param range This is how many steps the whole range of the value is. The factor is kept to a tenth of it so small ranges don't jump.
+ */
+static int key_acceleration(unsigned long range)
+{
+  int factor=1;
+  if (!ctx->key_repeat_enable) return 1;
+  if (ctx->key_repeats>=2*phi_prompt_accel_repeats) factor=100;
+  else if (ctx->key_repeats>=phi_prompt_accel_repeats) factor=10;
+  while ((factor>1)&&(factor*10UL>range)) factor/=10;
+  return factor;
+}
+
+/**
+ * \details This function is the center of phi_prompt key sensing. It takes key presses off the key queue in the order they were made, waiting up to ref_time in ms for one.
+ * Key presses are sensed by phi_prompt_scan_keys(), from Timer2 if phi_prompt_timer2_keys is defined or from this function while it waits.
+ * If a key press is sensed, it attempts to translate it into function keys or pass the result unaltered if it is not a function key.
+ * It only detects one key presses so holding multiple keys will not produce what you want.
+ * For function key codes, refer to the "Internal function key codes" section in the library header.
+ * \param ref_time This is the time the function is allowed to wait, while polling on all input keypads.
+ * \return Returns translated key or NO_KEY if no key is detected after the time expires.
+ */
+int wait_on_escape(int ref_time)
+{
+//Wait on button push.
+  long temp0;
+  byte temp1;
+  phi_prompt_flush(); // Show everything rendered so far before waiting on the user.
+#ifdef phi_prompt_stats
+  unsigned long entered=micros();
+  if (ctx->stats_mark) ctx->stats.busy_us+=entered-ctx->stats_mark;
+#endif
+  temp0=millis();
+  while(true)
+  {
+    phi_prompt_service(); // Keep the display fed while waiting.
+#ifndef phi_prompt_keys_in_isr
+    phi_prompt_scan_keys();
+#endif
+    temp1=next_key_event();
+#ifdef phi_prompt_stats
+    if ((temp1!=NO_KEY)&&ctx->trace) ctx->trace(temp1,phi_prompt_trace_key);
+#endif
+    if (temp1!=NO_KEY) break;
+    if (millis()-temp0>=ref_time) break;
+#ifdef phi_prompt_keys_in_isr
+    sleep_mode(); // Nothing to do until the next millis() tick or key scan.
+#endif
+  }
+#ifdef phi_prompt_stats
+  ctx->stats_mark=micros();
+  ctx->stats.idle_us+=ctx->stats_mark-entered;
+#endif
+  if (temp1!=NO_KEY) return (phi_prompt_translate(temp1));
+  return (NO_KEY);
+}
+
+static void select_list_key(phi_prompt_task *task, int key);
+static void input_integer_key(phi_prompt_task *task, int key);
+static void input_panel_key(phi_prompt_task *task, int key);
+static void input_number_key(phi_prompt_task *task, int key);
+static void input_fixed_key(phi_prompt_task *task, int key);
+static void text_area_key(phi_prompt_task *task, int key);
+
+/**
+ * \details Marks a task as finished with the value the blocking version of its widget returns.
+ */
+static void phi_prompt_finish(phi_prompt_task *task, int result)
+{
+  task->result=result;
+  task->widget=0;
 }
 
-void noBlink(){
-  int delayTime = 50;
-  lcd->write(0xFE); 
-  lcd->write(0x0C); 
-  delay(delayTime);
-}
+/**
+ * \details Runs one step of a widget started with one of the _begin functions, such as select_list_begin(). It senses keys once without waiting,
+ * handles at most one key press and the display update that goes with it, then returns. Call it from your loop() as often as you can.
+ * \param task This is the task you started the widget with.
+ * \return It returns true once the widget has finished. Its return value is then available from phi_prompt_result().
+ */
+boolean phi_prompt_poll(phi_prompt_task *task)
+{
+  if (task->widget==0) return true;
+  phi_prompt_context *caller=phi_prompt_bind(task->context);
+#ifdef phi_prompt_stats
+  ctx->widget=task->widget;
+#endif
+  int key=wait_on_escape(0);
+  switch (task->widget)
+  {
+    case phi_prompt_select_list:
+    select_list_key(task,key);
+    break;
 
-void cursor(){
-  int delayTime = 50;
-  lcd->write(0xFE); 
-  lcd->write(0x0E); 
-  delay(delayTime); 
+    case phi_prompt_input_integer:
+    case phi_prompt_input_long:
+    input_integer_key(task,key);
+    break;
+
+    case phi_prompt_input_fixed:
+    input_fixed_key(task,key);
+    break;
+
+    case phi_prompt_input_panel:
+    input_panel_key(task,key);
+    break;
+
+    case phi_prompt_input_number:
+    input_number_key(task,key);
+    break;
+
+    case phi_prompt_text_area:
+    case phi_prompt_text_area_P:
+    text_area_key(task,key);
+    break;
+
+    case phi_prompt_ok_dialog:
+    if (key!=NO_KEY) phi_prompt_finish(task,1);
+    break;
+  }
+  if (task->widget==0) phi_prompt_flush(); // Last update, such as hiding the cursor.
+#ifdef phi_prompt_stats
+  ctx->widget=0;
+#endif
+  phi_prompt_bind(caller);
+  return (task->widget==0);
 }
 
-void noCursor(){
-  int delayTime = 50;
-  lcd->write(0xFE); 
-  lcd->write(0x0C); 
-  delay(delayTime);
+/**
+ * \details Returns what the blocking version of the widget would have returned, such as 1 for enter and -1 for escape. Only valid once phi_prompt_poll() has returned true.
+ */
+int phi_prompt_result(phi_prompt_task *task)
+{
+  return task->result;
 }
 
-// Allows us to fill the first 8 CGRAM locations
-// with custom characters
-void createChar(uint8_t location, uint8_t charmap[]) {
-  location &= 0x7; // we only have 8 locations 0-7
-  lcd->write(254);   //command flag
-  lcd->write(64+location*8);  //clear command.
-  for (int i=0; i<8; i++) {
-    lcd->write(charmap[i]); 
-    }
+/**
+ * \details Runs a task until it finishes, for the blocking version of each widget. With phi_prompt_timer2_keys the CPU sleeps between polls
+ * while no key press is queued and the display has nothing left to send, and wakes on the next key scan, millis() tick or serial interrupt.
+ * \return It returns the value the widget finished with.
+ */
+static int run_task(phi_prompt_task *task)
+{
+  while (!phi_prompt_poll(task))
+  {
+#ifdef phi_prompt_keys_in_isr
+    phi_prompt_context *c=task->context;
+    if ((c->key_head==c->key_tail)&&(c->queue_head==c->queue_tail)) sleep_mode();
+#endif
   }
-//Interactions
+  return task->result;
+}
 
 /**
- * \details This function is the center of phi_prompt key sensing. It polls all input keypads for inputs for the length of ref_time in ms
- * If a key press is sensed, it attempts to translate it into function keys or pass the result unaltered if it is not a function key.
- * It only detects one key presses so holding multiple keys will not produce what you want.
- * For function key codes, refer to the "Internal function key codes" section in the library header.
- * \param ref_time This is the time the function is allowed to wait, while polling on all input keypads.
- * \return Returns translated key or NO_KEY if no key is detected after the time expires.
+ * \details Runs one step of each of several tasks in turn, such as one on a front operator display and one on a rear service display, then feeds every display.
+ * No task waits on another: each handles at most one key press and its display update per call. Call it from your loop() as often as you can.
+ * \param tasks This is an array of pointers to the tasks. Finished tasks are skipped, so a task can be started again in its slot once it has finished.
+ * \param count This is the number of tasks in the array.
+ * \return It returns the number of tasks still running.
  */
-int wait_on_escape(int ref_time)
+byte phi_prompt_poll_all(phi_prompt_task *tasks[], byte count)
 {
-//Wait on button push.
-  long temp0;
-  byte temp1;
-  temp0=millis();
-  do
+  byte running=0;
+  for (byte i=0;i<count;i++)
   {
-    byte i=0;
-    while(mbi_ptr[i])
-    {
-      temp1=mbi_ptr[i]->getKey();
-      if (temp1!=NO_KEY) return (phi_prompt_translate(temp1));
-      i++;
-    }
-  }   while ((millis()-temp0<ref_time));
-
-  return (NO_KEY);
+    if (!phi_prompt_poll(tasks[i])) running++;
+  }
+  phi_prompt_service_all();
+  return running;
 }
 
 //Inputs
@@ -801,7 +2153,7 @@ int wait_on_escape(int ref_time)
  * \details Input an integer value with wrap-around capability. Integers are inputted with up and down function keys. The value has upper and lower limits and step.
  * Pressing number keys has no effect since the input needs to be restricted with limits and steps.
  * This function prints the initial value first so the caller doesn't need to.
- * Function traps until the update is finalized by the left, right, enter button or escape button.
+ * Function traps until the update is finalized by the left, right, enter button or escape button. Use input_integer_begin() and phi_prompt_poll() if you can't afford that.
  * Return values are updated throught the pointer.
  * \param para This is the phi_prompt struct to carry information between callers and functions.
  * Display options for integers:
@@ -814,178 +2166,377 @@ int wait_on_escape(int ref_time)
  */
 int input_integer(phi_prompt_struct *para)
 {
-  
-  int number=*(para->ptr.i_buffer);
-  byte temp1;
-  byte space=para->width;
-  char msg[space+1];
-  char format[]="%00d";
-  for (byte i=0;i<space;i++) msg[i]=' '; // Create mask the size of the output space.
-  msg[space]=0;
-  setCursor(para->col,para->row); // Write mask to erase previous content.
-  lcd->print(msg);
-  setCursor(para->col,para->row); // Write initial value.
-  switch (para->option) // Prints out the content once before accepting user inputs.
-  {
-    case 0://padding with space to the right (padding done in erasing phase)
-    sprintf(msg,"%d",number);
-    break;
+  phi_prompt_task task;
+  input_integer_begin(&task,para);
+  return run_task(&task);
+}
+
+/**
+ * \details Renders the value of input_integer or input_long according to the display option.
+ * The whole field goes to the shadow in one pass and only the digits that differ from what the display shows are sent, so the cursor moves once at most.
+ */
+static void input_integer_render(phi_prompt_task *task)
+{
+  phi_prompt_struct *para=task->para;
+  char *msg=scratch_take(para->width+1);
+  if (msg==0) return;
+  phi_prompt_format_number(msg,task->number,para->width,0,para->option);
+  place_cursor(para->col,para->row);
+  phi_prompt_print(msg);
+  scratch_give(msg);
+  place_cursor(para->col,para->row);
+}
+
+/**
+ * \details Returns the lower limit, upper limit or step of input_integer from the int members of para, or of input_long from the long members.
+ */
+static long input_integer_limit(phi_prompt_task *task, four_bytes *limit)
+{
+  if (task->widget==phi_prompt_input_long) return limit->l;
+  return limit->i;
+}
+
+/**
+ * \details Stores the value being edited back to the caller's variable.
+ */
+static void input_integer_store(phi_prompt_task *task)
+{
+  if (task->widget==phi_prompt_input_long) *(task->para->ptr.l_buffer)=task->number;
+  else *(task->para->ptr.i_buffer)=task->number;
+}
+
+/**
+ * \details Starts input_integer without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the input between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See input_integer().
+ */
+void input_integer_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_input_integer;
+  task->number=*(para->ptr.i_buffer);
+  task->render=0;
+  input_integer_render(task); // Prints out the content once before accepting user inputs.
+  cursor();
+}
+
+/**
+ * \details Input a long value with wrap-around capability, the same as input_integer but with long limits and step in low.l, high.l and step.l and the value in ptr.l_buffer.
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See input_integer().
+ * \return Returns function keys pushed the same as input_integer.
+ */
+int input_long(phi_prompt_struct *para)
+{
+  phi_prompt_task task;
+  input_long_begin(&task,para);
+  return run_task(&task);
+}
 
-    case 1://padding with zero to the right
-    format[2]+=space;
-    sprintf(msg,format,number);
+/**
+ * \details Starts input_long without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the input between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See input_long().
+ */
+void input_long_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_input_long;
+  task->number=*(para->ptr.l_buffer);
+  task->render=0;
+  input_integer_render(task); // Prints out the content once before accepting user inputs.
+  cursor();
+}
+
+static void input_integer_key(phi_prompt_task *task, int key)
+{
+  phi_prompt_struct *para=task->para;
+  long low=input_integer_limit(task,&para->low), high=input_integer_limit(task,&para->high), step=input_integer_limit(task,&para->step);
+  if (step==0) step=1; // A step of 0 would never move the value and would divide the range by 0.
+  long single=step;
+  if ((task->render)&&(key!=phi_prompt_up)&&(key!=phi_prompt_down)&&((key!=NO_KEY)||(ctx->queue_count==0))) // Show the value the keys held have reached once they are let go and the display has caught up.
+  {
+    input_integer_render(task);
+    task->render=0;
+  }
+  switch (key)
+  {
+    case phi_prompt_up:
+    step*=key_acceleration(((unsigned long)high-(unsigned long)low)/step); // Unsigned, since the span of two longs may not fit in one.
+    if ((task->number<high)&&((unsigned long)high-(unsigned long)task->number>=(unsigned long)step)) task->number+=step; // Compare distances so number+step can't overflow near LONG_MAX.
+    else if (step>single) task->number=high; // Stop at the end rather than wrap around while accelerating.
+    else task->number=low;
+    task->render=1;
+    break;
+    
+    case phi_prompt_down:
+    step*=key_acceleration(((unsigned long)high-(unsigned long)low)/step);
+    if ((task->number>low)&&((unsigned long)task->number-(unsigned long)low>=(unsigned long)step)) task->number-=step;
+    else if (step>single) task->number=low;
+    else task->number=high;
+    task->render=1;
+    break;
+    
+    case phi_prompt_left: // Left is pressed
+    input_integer_store(task);
+    noCursor();
+    phi_prompt_finish(task,-3);
+    break;
+    
+    case phi_prompt_right: // Right is pressed
+    input_integer_store(task);
+    noCursor();
+    phi_prompt_finish(task,-4);
     break;
+    
+    case phi_prompt_enter: // Enter is pressed
+    input_integer_store(task);
+    noCursor();
+    phi_prompt_finish(task,1);
+    break;
+    
+    case phi_prompt_escape: // Escape is pressed
+    noCursor();
+    phi_prompt_finish(task,-1);
+    break;
+    
+    default:
+    break;
+  }
+  if ((task->render)&&(ctx->key_tail==ctx->key_head)&&(ctx->queue_count==0)) // Skip drawing values that more queued key presses or a busy display would overwrite at once.
+  {
+    input_integer_render(task);
+    task->render=0;
   }
+}
+
+/**
+ * \details Input a fixed point value digit by digit. The value is a long scaled by ten to the number of digits after the decimal point, so 12.50 with two digits after the point is 1250.
+ * Up and down change the digit under the cursor, number keys type over it and left and right move between digits, skipping the decimal point.
+ * With options 1 and 2 the sign takes the first cell before the decimal point, as it did in input_float's old layout, so the field is as wide as before. It is fixed with option 1 and toggled with up, down or the '-' key with option 2.
+ * This function prints the initial value first so the caller doesn't need to.
+ * Function traps until the update is finalized by the left, right, enter button or escape button. Use input_fixed_begin() and phi_prompt_poll() if you can't afford that.
+ * Return values are updated throught the pointer ptr.l_buffer.
+ * \param para This is the phi_prompt struct to carry information between callers and functions. step.c_arr[1] is the number of cells before the decimal point, the sign cell included, and step.c_arr[0] the number of digits after it.
+ * The field is step.c_arr[1]+step.c_arr[0]+1 cells wide, or one more when a sign has only one cell before the point, so the sign gets its own. With no digits after it there is no decimal point and no cell for it. The digits are cut down to phi_prompt_fixed_digits in all, keeping at least one before the point. A value too big for the digits starts out as the biggest they hold.
+ * Display options for fixed point values:
+ * 0: only positive numbers allowed, 1: only negative numbers allowed, 2: both positive and negative numbers are allowed.
+ * \return Returns function keys pushed so the caller can determine what to do:
+ * Go back to the last slot with left (-3)
+ * Go forward to the next slot with right (-4)
+ * Enter(1)
+ * Escape(-1).
+ */
+int input_fixed(phi_prompt_struct *para)
+{
+  phi_prompt_task task;
+  input_fixed_begin(&task,para);
+  return run_task(&task);
+}
+
+/**
+ * \details Reads the number of digits of input_fixed before and after the decimal point, cut down to what a long holds: phi_prompt_fixed_digits in all with at least one before the point.
+ * The sign of options 1 and 2 takes one of the cells before the point.
+ */
+static void input_fixed_digits(phi_prompt_struct *para, byte *before, byte *after)
+{
+  *after=para->step.c_arr[0];
+  if (*after>phi_prompt_fixed_digits-1) *after=phi_prompt_fixed_digits-1;
+  *before=para->step.c_arr[1];
+  if ((para->option!=0)&&(*before>1)) (*before)--;
+  if (*before>phi_prompt_fixed_digits-*after) *before=phi_prompt_fixed_digits-*after;
+  if (*before<1) *before=1;
+}
+
+/**
+ * \details Returns the number of cells input_fixed takes: the sign cell if there is one, the digits and the decimal point if there are digits after it.
+ */
+static byte input_fixed_cells(phi_prompt_struct *para)
+{
+  byte before, after;
+  input_fixed_digits(para,&before,&after);
+  return (para->option!=0)+before+(after?after+1:0);
+}
+
+/**
+ * \details Returns the place value of the digit at a cell of input_fixed, such as 100 for the hundreds, or 0 for the sign and decimal point cells.
+ */
+static long input_fixed_place(phi_prompt_task *task, byte cell)
+{
+  phi_prompt_struct *para=task->para;
+  byte before, after, sign=(para->option!=0);
+  input_fixed_digits(para,&before,&after);
+  long place=1;
+  if ((cell<sign)||(after&&(cell==sign+before))||(cell>=input_fixed_cells(para))) return 0;
+  byte digit=cell-sign;
+  if (digit>before) digit--; // Skip the decimal point.
+  for (byte i=digit+1;i<before+after;i++) place*=10;
+  return place;
+}
+
+/**
+ * \details Renders the value of input_fixed, the sign cell first when there is one, and puts the cursor on the digit being edited.
+ */
+static void input_fixed_render(phi_prompt_task *task)
+{
+  phi_prompt_struct *para=task->para;
+  byte before, after, sign=(para->option!=0);
+  input_fixed_digits(para,&before,&after);
+  char *msg=scratch_take(input_fixed_cells(para)+1);
+  if (msg==0) return;
+  if (sign) msg[0]=task->negative?'-':' ';
+  phi_prompt_format_number(msg+sign,task->number,before+(after?after+1:0),after,1); // No decimal point without digits after it.
+  place_cursor(para->col,para->row);
+  phi_prompt_print(msg);
+  scratch_give(msg);
+  place_cursor(para->col+task->pointer,para->row);
+}
+
+/**
+ * \details Stores the value being edited back to the caller's variable with its sign.
+ */
+static void input_fixed_store(phi_prompt_task *task)
+{
+  *(task->para->ptr.l_buffer)=task->negative?-task->number:task->number;
+}
 
-  lcd->print(msg);
-  setCursor(para->col,para->row); // Write initial value.
+/**
+ * \details Starts input_fixed without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the input between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See input_fixed().
+ */
+void input_fixed_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  long value=*(para->ptr.l_buffer), limit=1;
+  byte before, after;
+  input_fixed_digits(para,&before,&after);
+  for (byte i=0;i<before+after;i++) limit*=10;
+  task->para=para;
+  task->widget=phi_prompt_input_fixed;
+  task->negative=(para->option==1)||((para->option==2)&&(value<0));
+  unsigned long magnitude=(value<0)?0UL-(unsigned long)value:value;
+  task->number=(magnitude<(unsigned long)limit)?magnitude:limit-1; // A value too big for the field starts as the biggest it holds rather than lose its top digits.
+  task->pointer=(para->option==1); // The fixed sign of option 1 can't be edited.
+  input_fixed_render(task); // Prints out the content once before accepting user inputs.
   cursor();
+}
 
-  while(true)
+static void input_fixed_key(phi_prompt_task *task, int key)
+{
+  phi_prompt_struct *para=task->para;
+  byte before, after, sign=(para->option!=0), last=input_fixed_cells(para)-1;
+  input_fixed_digits(para,&before,&after);
+  long place=input_fixed_place(task,task->pointer);
+  byte digit=place?(task->number/place)%10:0;
+  switch (key)
   {
-    temp1=wait_on_escape(50);
-    switch (temp1)
-    {
-      case phi_prompt_up:
-      if (number+(para->step.i)<=(para->high.i)) number+=(para->step.i);
-      else number=para->low.i;
-      setCursor(para->col,para->row);
-      for (byte i=0;i<space;i++) msg[i]=' '; // Create mask the size of the output space.
-      msg[space]=0;
-      lcd->print(msg);
-      setCursor(para->col,para->row);
-      
-      switch (para->option)
-      {
-        case 0://padding with space to the right (padding done in erasing phase)
-        sprintf(msg,"%d",number);
-        break;
-
-        case 1://padding with zero to the right
-        format[2]='0'+space;
-        sprintf(msg,format,number);
-        break;
-      }
+    case phi_prompt_up:
+    if (place) task->number+=(digit==9)?-9*place:place;
+    else task->negative=!task->negative; // Only the sign cell of option 2 has no place value.
+    input_fixed_render(task);
+    break;
 
-      lcd->print(msg);
-      setCursor(para->col,para->row);
-      break;
-      
-      case phi_prompt_down:
-      if (number-para->step.i>=para->low.i) number-=para->step.i;
-      else number=para->high.i;
-      setCursor(para->col,para->row);
-      for (byte i=0;i<space;i++) msg[i]=' '; // Create mask the size of the output space.
-      msg[space]=0;
-      lcd->print(msg);
-      setCursor(para->col,para->row);
-
-      switch (para->option)
-      {
-        case 0://padding with space to the right (padding done in erasing phase)
-        sprintf(msg,"%d",number);
-        break;
-
-        case 1://padding with zero to the right
-        format[2]='0'+space;
-        sprintf(msg,format,number);
-        break;
-      }
+    case phi_prompt_down:
+    if (place) task->number-=(digit==0)?-9*place:place;
+    else task->negative=!task->negative;
+    input_fixed_render(task);
+    break;
 
-      lcd->print(msg);
-      setCursor(para->col,para->row);
-      break;
-      
-      case phi_prompt_left: // Left is pressed
-      *(para->ptr.i_buffer)=number;
-      noCursor();
-      return (-3);
-      break;
-      
-      case phi_prompt_right: // Right is pressed
-      *(para->ptr.i_buffer)=number;
-      noCursor();
-      return (-4);
-      break;
-      
-      case phi_prompt_enter: // Enter is pressed
-      *(para->ptr.i_buffer)=number;
+    case phi_prompt_left: // Left is pressed
+    if (task->pointer>(para->option==1))
+    {
+      task->pointer--;
+      if (after&&(task->pointer==sign+before)) task->pointer--; // Skip the decimal point.
+      place_cursor(para->col+task->pointer,para->row);
+    }
+    else
+    {
+      input_fixed_store(task);
       noCursor();
-      return(1);
-      break;
-      
-      case phi_prompt_escape: // Escape is pressed
+      phi_prompt_finish(task,-3);
+    }
+    break;
+
+    case phi_prompt_right: // Right is pressed
+    if (task->pointer<last)
+    {
+      task->pointer++;
+      if (after&&(task->pointer==sign+before)) task->pointer++;
+      place_cursor(para->col+task->pointer,para->row);
+    }
+    else
+    {
+      input_fixed_store(task);
       noCursor();
-      return (-1);
-      break;
-      
-      default:
-      break;
+      phi_prompt_finish(task,-4);
     }
-  }
-}
+    break;
 
-/*
-This is still supported but not number keypad support has not been expanded to it and it will disappear from the library in future releases.
-Input a floating point value with fixed decimal point. Ironic but true.
-This function prints the initial value first so the caller doesn't need to.
-Function traps until the update is finalized by the enter button or escape button.
-Return values are updated throught the pointer.
-Returns buttons pushed so the caller can determine what to do:
-Go back to the last slot with left (-3)
-Go forward to the next slot with right (-4)
-Enter(1)
-Escape(-1).
-Display options for floats:
-0: only positive numbers allowed, 1: only negative numbers allowed, 2: both positive and negative numbers are allowed.
-*/
-int input_float(phi_prompt_struct *para)
-{
-  phi_prompt_struct myTextInput;
-  char number[17]; // This is the buffer that will store the content of the text panel.
-  char format[]="%04d.%02d";
-  byte before=para->step.c_arr[1], after=para->step.c_arr[0]; // How many digits to display before and after decimal point.
-  int ret;
-  format[2]=before+'0';
-  format[7]=after+'0';
-  sprintf(number,format,int(*para->ptr.f_buffer),int((*para->ptr.f_buffer-int(*para->ptr.f_buffer))*pow(10,after)*(*para->ptr.f_buffer>0?1:-1)+0.5)); // Form the string to represent current value. This string will be the default value of the float input.
-
-  myTextInput.ptr.msg=number; // Assign the text buffer address
-  myTextInput.width=before+after+1; // Length of the input panel is 12 characters.
-  myTextInput.col=para->col; // Display input panel at required column
-  myTextInput.row=para->row; // Display input panel at required row
-  switch (para->option)
-  {
-    case 0:
-    myTextInput.low.c='0'; // Text panel valid input starts with character '-'.
-    myTextInput.high.c='9'; // Text panel valid input ends with character '-'. Could end with '.' if real floating number is enabled.
-    myTextInput.option=0; // Option 1 incluess 0-9 as valid characters. Option 0, default, option 1 include 0-9 as valid inputs.
+    case phi_prompt_enter: // Enter is pressed
+    input_fixed_store(task);
+    noCursor();
+    phi_prompt_finish(task,1);
     break;
 
-    case 1:
-    number[0]='-';
-    myTextInput.low.c='0'; // Text panel valid input starts with character '-'.
-    myTextInput.high.c='9'; // Text panel valid input ends with character '-'. Could end with '.' if real floating number is enabled.
-    myTextInput.option=0; // Option 1 incluess 0-9 as valid characters. Option 0, default, option 1 include 0-9 as valid inputs.
+    case phi_prompt_escape: // Escape is pressed
+    noCursor();
+    phi_prompt_finish(task,-1);
     break;
 
-    case 2:
-    myTextInput.low.c='-'; // Text panel valid input starts with character '-'.
-    myTextInput.high.c='-'; // Text panel valid input ends with character '-'. Could end with '.' if real floating number is enabled.
-    myTextInput.option=1; // Option 1 incluess 0-9 as valid characters. Option 0, default, option 1 include 0-9 as valid inputs.
+    case '-':
+    if (para->option==2)
+    {
+      task->negative=!task->negative;
+      input_fixed_render(task);
+    }
     break;
 
-    default:
+    default: // Number keys type over the digit under the cursor and move on to the next digit.
+    if ((key>='0')&&(key<='9')&&place)
+    {
+      task->number+=(key-'0'-digit)*place;
+      if (task->pointer<last) task->pointer++;
+      if (after&&(task->pointer==sign+before)) task->pointer++;
+      input_fixed_render(task);
+    }
     break;
   }
-  
-  ret=input_panel(&myTextInput);
-  if (ret!=-1)
-  {  
-    sscanf(number,"%d%*c%d",&myTextInput.high.i,&myTextInput.low.i);
-    *para->ptr.f_buffer=(-1)*(myTextInput.high.i<0?1:-1)*myTextInput.low.i/pow(10.0,(float)after)+myTextInput.high.i;
-  }
-  return ret;  
+}
+
+/**
+ * \details Input a floating point value with fixed decimal point. Ironic but true.
+ * The value is edited with input_fixed as a long scaled by ten to the number of digits after the decimal point, and only converted from and to float here. step.c_arr[1] is the number of cells before the decimal point, the sign included, and step.c_arr[0] the number of digits after it, as for input_fixed().
+ * This function prints the initial value first so the caller doesn't need to.
+ * Function traps until the update is finalized by the left, right, enter button or escape button.
+ * Return values are updated throught the pointer.
+ * \param para This is the phi_prompt struct to carry information between callers and functions.
+ * Display options for floats:
+ * 0: only positive numbers allowed, 1: only negative numbers allowed, 2: both positive and negative numbers are allowed.
+ * \return Returns function keys pushed so the caller can determine what to do:
+ * Go back to the last slot with left (-3)
+ * Go forward to the next slot with right (-4)
+ * Enter(1)
+ * Escape(-1).
+ */
+int input_float(phi_prompt_struct *para)
+{
+  phi_prompt_struct fixed=*para;
+  long scale=1, limit=1, value;
+  byte before, after;
+  int ret;
+  input_fixed_digits(para,&before,&after);
+  for (byte i=0;i<after;i++) scale*=10;
+  for (byte i=0;i<before+after;i++) limit*=10;
+  float scaled=*para->ptr.f_buffer*scale;
+  if (scaled>=limit) value=limit-1; // Clamp before converting, as a float beyond what a long holds doesn't convert.
+  else if (scaled<=-limit) value=1-limit;
+  else value=scaled+((scaled<0)?-0.5:0.5); // Round to the nearest digit shown.
+  fixed.ptr.l_buffer=&value;
+  ret=input_fixed(&fixed);
+  if (ret!=-1) *para->ptr.f_buffer=(float)value/scale;
+  return ret;
 }
 
 /**
@@ -995,69 +2546,83 @@ int input_float(phi_prompt_struct *para)
  * Option 0: display classic list, option 1: display MXN list, option 2: display list with index, option 3: display list with index2, option 4: display MXN list with scrolling
  *
  * This function prints the initial value first so the caller doesn't need to.
- * Function traps until the update is finalized by the left, right, enter button or escape button.
+ * Function traps until the update is finalized by the left, right, enter button or escape button. Use select_list_begin() and phi_prompt_poll() if you can't afford that.
  * Return values are updated throught the pointer.
  * \return Returns buttons pushed so the caller can determine what to do. The function returns 1 if enter is pressed, -1 if the input is cancelled.
  */
 int select_list(phi_prompt_struct *para)
 {
-  int temp1;
-  byte render, width=para->width;
-  char msg[width+1];
-  render=render_list(para);
-  while(true)
+  phi_prompt_task task;
+  select_list_begin(&task,para);
+  return run_task(&task);
+}
+
+/**
+ * \details Starts select_list without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the list between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See select_list().
+ */
+void select_list_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_select_list;
+  task->render=render_list(para);
+  task->tick=millis()/phi_prompt_scroll_time;
+}
+
+static void select_list_key(phi_prompt_task *task, int key)
+{
+  phi_prompt_struct *para=task->para;
+  byte columns=para->step.c_arr[1], rows=para->step.c_arr[0];
+  long current=list_current(para), last=list_last(para);
+  switch (key)
   {
-    temp1=wait_on_escape(50);
-    byte columns=para->step.c_arr[1], rows=para->step.c_arr[0];
-    switch (temp1)
+    case NO_KEY:
+    if ((task->render)&&(millis()/phi_prompt_scroll_time!=task->tick)&&(ctx->queue_count==0)) // Draw a scroll position only once it is due and the last one has gone out, so a slow display drops positions instead of falling behind.
     {
-      case NO_KEY:
-      if (render)
-      {
-        render=render_list(para);
-      }
-      break;
-      
-      case phi_prompt_up: ///< Up is pressed. Move to the previous item.
-      if (para->low.i-1>=0) para->low.i--;
-      else para->low.i=para->high.i;
-      render=render_list(para);
-      break;
-      
-      case phi_prompt_down: ///< Down is pressed. Move to the next item.
-      if ((para->low.i+1)<=(para->high.i)) para->low.i++;
-      else para->low.i=0;
-      render=render_list(para);
-      break;
-      
-      case phi_prompt_left: ///< Left is pressed
-      if (para->low.i-para->row>=0) para->low.i-=para->row;
-      render=render_list(para);
-      break;
-      
-      case phi_prompt_right: ///< Right is pressed
-      if (para->low.i+para->row<=para->high.i) para->low.i+=para->row;
-      render=render_list(para);
-      break;
-      
-      case phi_prompt_enter: ///< Enter is pressed
-      noCursor();
-      return(1);
-      break;
-      
-      case phi_prompt_escape: ///< Escape is pressed
-      noCursor();
-      return (-1);
-      break;
-      
-      default: ///< Any other keys will flip the list to the next page.
-      if ((para->low.i+columns*rows)<=(para->high.i)) para->low.i+=columns*rows;
-      else if (para->low.i==para->high.i) para->low.i=0;
-      else para->low.i=para->high.i;
-      render=render_list(para);
-      break;
+      task->render=render_scrolling_item(para);
+      task->tick=millis()/phi_prompt_scroll_time;
     }
+    return;
+    
+    case phi_prompt_up: ///< Up is pressed. Move to the previous item.
+    if (current-1>=0) current--;
+    else current=last;
+    break;
+    
+    case phi_prompt_down: ///< Down is pressed. Move to the next item.
+    if ((current+1)<=last) current++;
+    else current=0;
+    break;
+    
+    case phi_prompt_left: ///< Left is pressed
+    if (current-para->row>=0) current-=para->row;
+    break;
+    
+    case phi_prompt_right: ///< Right is pressed
+    if (current+para->row<=last) current+=para->row;
+    break;
+    
+    case phi_prompt_enter: ///< Enter is pressed
+    noCursor();
+    phi_prompt_finish(task,1);
+    return;
+    
+    case phi_prompt_escape: ///< Escape is pressed
+    noCursor();
+    phi_prompt_finish(task,-1);
+    return;
+    
+    default: ///< Any other keys will flip the list to the next page.
+    if ((current+columns*rows)<=last) current+=columns*rows;
+    else if (current==last) current=0;
+    else current=last;
+    break;
   }
+  set_list_current(para,current);
+  task->render=render_list(para);
+  task->tick=millis()/phi_prompt_scroll_time;
 }
 
 /**
@@ -1072,98 +2637,194 @@ int select_list(phi_prompt_struct *para)
  * The function fills the buffer after the last character with \0 only if the buffer is not filled. The caller is responsible to fill the character beyond the end of the buffer with \0.
  * Input character options for input panel:
  * Option 0: default, option 1: include 0-9 as valid inputs, option 2: only 0-9 are valid, option 3: only 0-9 are valid and the first digit can be '-', option 4: only 0-9 are valid and number increments, option 5: only 0-9 are valid and the first digit can be '-' and number increments.
- * To do:
- * Option 2-4, automatically increment or decrement a whole series of numbers when they are connected, such as File0009.txt when increase 9 (if only 0-9 are allowed) will give File0010.txt.
+ * With options 4 and 5, up and down carry into the digits to the left, such as File0009.txt when increase 9 will give File0010.txt.
+ * With options 0 and 1 and multi-tap enabled with enable_multi_tap(), tapping a number key cycles through its letters in place, such as A, B, C, 2 for key 2.
+ * The character is accepted when another multi-tap key is pressed or phi_prompt_tap_time passes, and the cursor moves on.
  * \return The function returns number of actual characters. The function returns -1 if the input is cancelled.
  */
 int input_panel(phi_prompt_struct *para)
 {
-  byte pointer=0, chr;
-  int temp1;
-  setCursor(para->col,para->row);
-  lcd->print(para->ptr.msg);
-  setCursor(para->col,para->row);
+  phi_prompt_task task;
+  input_panel_begin(&task,para);
+  return run_task(&task);
+}
+
+/**
+ * \details Starts input_panel without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the input between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See input_panel().
+ */
+void input_panel_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_input_panel;
+  task->pointer=0;
+  task->tap_key=0;
+  place_cursor(para->col,para->row);
+  phi_prompt_print(para->ptr.msg);
+  place_cursor(para->col,para->row);
   cursor();
-  while(true)
+}
+
+/**
+ * \details Writes a character of input_panel's buffer to its cell and leaves the display cursor on the character being edited.
+ */
+static void input_panel_cell(phi_prompt_task *task, byte i, char ch)
+{
+  phi_prompt_struct *para=task->para;
+  *(para->ptr.msg+i)=ch;
+  place_cursor(i+para->col,para->row);
+  phi_prompt_write(ch);
+  place_cursor(task->pointer+para->col,para->row);
+}
+
+/**
+ * \details Carries an increment or decrement of the current digit into the digits to its left, for input_panel options 4 and 5.
+ * \param up This is true for a carry, false for a borrow.
+ */
+static void input_panel_carry(phi_prompt_task *task, boolean up)
+{
+  char *msg=task->para->ptr.msg;
+  for (byte i=task->pointer;i>0;i--)
   {
-    temp1=wait_on_escape(50);
-    chr=*(para->ptr.msg+pointer); // Loads the current character.
-    switch (temp1)
+    char ch=msg[i-1];
+    if ((ch<'0')||(ch>'9')) break; // The number ends here.
+    if (up)
+    {
+      input_panel_cell(task,i-1,(ch=='9')?'0':ch+1);
+      if (ch!='9') break;
+    }
+    else
+    {
+      input_panel_cell(task,i-1,(ch=='0')?'9':ch-1);
+      if (ch!='0') break;
+    }
+  }
+}
+
+/**
+ * \details Accepts the character multi-tap is cycling in input_panel and moves the cursor on.
+ */
+static void input_panel_tap_done(phi_prompt_task *task)
+{
+  task->tap_key=0;
+  if (task->pointer<(task->para->width)-1) task->pointer++;
+  place_cursor(task->pointer+task->para->col,task->para->row);
+}
+
+/**
+ * \details Handles a multi-tap key in input_panel: the same key again within phi_prompt_tap_time cycles the character in place, any other starts on the next character.
+ * \return It returns false if key doesn't multi-tap, so it is handled as a plain key.
+ */
+static boolean input_panel_tap(phi_prompt_task *task, int key)
+{
+  byte k=0;
+  char ch;
+  while (((ch=pgm_read_byte(ctx->tap_keys+k))!=0)&&(ch!=key)) k++;
+  if (ch==0) return false;
+  PGM_P charset=(PGM_P)pgm_read_word(ctx->tap_charsets+k);
+  if ((task->tap_key==key)&&(millis()-task->tick<phi_prompt_tap_time)) task->taps++;
+  else
+  {
+    if (task->tap_key) input_panel_tap_done(task);
+    task->tap_key=key;
+    task->taps=0;
+  }
+  if (pgm_read_byte(charset+task->taps)==0) task->taps=0; // Past the last character, back to the first.
+  task->tick=millis();
+  input_panel_cell(task,task->pointer,pgm_read_byte(charset+task->taps));
+  return true;
+}
+
+static void input_panel_key(phi_prompt_task *task, int key)
+{
+  phi_prompt_struct *para=task->para;
+  if (task->tap_key) // A multi-tap character is being cycled.
+  {
+    if (key==NO_KEY)
+    {
+      if (millis()-task->tick>=phi_prompt_tap_time) input_panel_tap_done(task);
+      return;
+    }
+    if (input_panel_tap(task,key)) return; // The same key cycles the character, another multi-tap key starts the next one.
+    task->tap_key=0; // Other keys work on the character just typed.
+  }
+  else if ((ctx->multi_tap_enable)&&(para->option<=1)&&(key!=NO_KEY)&&input_panel_tap(task,key)) return;
+  byte chr=*(para->ptr.msg+task->pointer); // Loads the current character.
+  switch (key)
+  {
+    case phi_prompt_up:
+    *(para->ptr.msg+task->pointer)=inc(chr, para);
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    place_cursor(task->pointer+para->col,para->row);
+    if (((para->option==4)||(para->option==5))&&(chr=='9')&&(*(para->ptr.msg+task->pointer)=='0')) input_panel_carry(task,true);
+    break;
+    
+    case phi_prompt_down:
+    *(para->ptr.msg+task->pointer)=dec(chr, para);
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    place_cursor(task->pointer+para->col,para->row);
+    if (((para->option==4)||(para->option==5))&&(chr=='0')&&(*(para->ptr.msg+task->pointer)=='9')) input_panel_carry(task,false);
+    break;
+    
+    case phi_prompt_left: // Left is pressed
+    if (task->pointer>0)
+    {
+      task->pointer--;
+      place_cursor(task->pointer+para->col,para->row);
+    }
+    else
     {
-      case phi_prompt_up:
-      *(para->ptr.msg+pointer)=inc(chr, para);
-      lcd->write(*(para->ptr.msg+pointer));
-      setCursor(pointer+para->col,para->row);
-      
-      //do automatic increment
-      break;
-      
-      case phi_prompt_down:
-      *(para->ptr.msg+pointer)=dec(chr, para);
-      lcd->write(*(para->ptr.msg+pointer));
-      setCursor(pointer+para->col,para->row);
-      
-      //do automatic decrement
-      break;
-      
-      case phi_prompt_left: // Left is pressed
-      if (pointer>0)
-      {
-        pointer--;
-        setCursor(pointer+para->col,para->row);
-      }
-      else
-      {
-        noCursor();
-        return (-3);
-      }
-      break;
-      
-      case '\b': ///< Back space is pressed. Erase the current character with space and back up one character.
-      *(para->ptr.msg+pointer)=' ';
-      lcd->write(*(para->ptr.msg+pointer));
-      if (pointer>0)
-      {
-        pointer--;
-      }
-      setCursor(pointer+para->col,para->row);
-      break;
-      
-      case phi_prompt_right: ///< Right is pressed
-      if (pointer<(para->width)-1)
-      {
-        pointer++;
-        setCursor(pointer+para->col,para->row);
-      }
-      else
-      {
-        noCursor();
-        return (-4);
-      }
-      break;
-      
-      case phi_prompt_enter: ///< Enter is pressed
-      case '\n': ///< New line is received
       noCursor();
-      return(1);
-      break;
-      
-      case phi_prompt_escape: ///< Escape is pressed
+      phi_prompt_finish(task,-3);
+    }
+    break;
+    
+    case '\b': ///< Back space is pressed. Erase the current character with space and back up one character.
+    *(para->ptr.msg+task->pointer)=' ';
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    if (task->pointer>0)
+    {
+      task->pointer--;
+    }
+    place_cursor(task->pointer+para->col,para->row);
+    break;
+    
+    case phi_prompt_right: ///< Right is pressed
+    if (task->pointer<(para->width)-1)
+    {
+      task->pointer++;
+      place_cursor(task->pointer+para->col,para->row);
+    }
+    else
+    {
       noCursor();
-      return (-1);
-      break;
-      
-      default: ///< Other keys were pressed
-      if (temp1==NO_KEY) break;
-      *(para->ptr.msg+pointer)=temp1;
-      lcd->write(*(para->ptr.msg+pointer));
-      if (pointer<(para->width)-1)
-      {
-        pointer++;
-      }
-      setCursor(pointer+para->col,para->row);
-      break;
+      phi_prompt_finish(task,-4);
+    }
+    break;
+    
+    case phi_prompt_enter: ///< Enter is pressed
+    case '\n': ///< New line is received
+    noCursor();
+    phi_prompt_finish(task,1);
+    break;
+    
+    case phi_prompt_escape: ///< Escape is pressed
+    noCursor();
+    phi_prompt_finish(task,-1);
+    break;
+    
+    default: ///< Other keys were pressed
+    if (key==NO_KEY) break;
+    *(para->ptr.msg+task->pointer)=key;
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    if (task->pointer<(para->width)-1)
+    {
+      task->pointer++;
     }
+    place_cursor(task->pointer+para->col,para->row);
+    break;
   }
 }
 
@@ -1183,203 +2844,220 @@ int input_panel(phi_prompt_struct *para)
  */
 int input_number(phi_prompt_struct *para)
 {
-  byte pointer=0, chr;
-  int temp1;
-  setCursor(para->col,para->row);
-  lcd->print(para->ptr.msg);
-  setCursor(para->col,para->row);
+  phi_prompt_task task;
+  input_number_begin(&task,para);
+  return run_task(&task);
+}
+
+/**
+ * \details Starts input_number without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the input between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See input_number().
+ */
+void input_number_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_input_number;
+  task->pointer=0;
+  place_cursor(para->col,para->row);
+  phi_prompt_print(para->ptr.msg);
+  place_cursor(para->col,para->row);
   cursor();
-  while(true)
+}
+
+static void input_number_key(phi_prompt_task *task, int key)
+{
+  phi_prompt_struct *para=task->para;
+  switch (key)
   {
-    temp1=wait_on_escape(50);
-    chr=*(para->ptr.msg+pointer); // Loads the current character.
-    switch (temp1)
+    case phi_prompt_up: ///< Up key outputs a negative sign and moves cursor to the right.
+    *(para->ptr.msg+task->pointer)='-';
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    if (task->pointer<(para->width)-1)
+    {
+      task->pointer++;
+    }
+    place_cursor(task->pointer+para->col,para->row);
+    break;
+    
+    case phi_prompt_down:
+    *(para->ptr.msg+task->pointer)='.'; ///< Down key outputs a decimal sign and moves cursor to the right.
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    if (task->pointer<(para->width)-1)
+    {
+      task->pointer++;
+    }
+    place_cursor(task->pointer+para->col,para->row);
+    break;
+    
+    case phi_prompt_left: // Left is pressed
+    if (task->pointer>0)
+    {
+      task->pointer--;
+      place_cursor(task->pointer+para->col,para->row);
+    }
+    else
     {
-      case phi_prompt_up: ///< Up key outputs a negative sign and moves cursor to the right.
-      *(para->ptr.msg+pointer)='-';
-      lcd->write(*(para->ptr.msg+pointer));
-      if (pointer<(para->width)-1)
-      {
-        pointer++;
-      }
-      setCursor(pointer+para->col,para->row);
-      break;
-      
-      case phi_prompt_down:
-      *(para->ptr.msg+pointer)='.'; ///< Down key outputs a decimal sign and moves cursor to the right.
-      lcd->write(*(para->ptr.msg+pointer));
-      if (pointer<(para->width)-1)
-      {
-        pointer++;
-      }
-      setCursor(pointer+para->col,para->row);
-      break;
-      
-      case phi_prompt_left: // Left is pressed
-      if (pointer>0)
-      {
-        pointer--;
-        setCursor(pointer+para->col,para->row);
-      }
-      else
-      {
-        noCursor();
-        return (-3);
-      }
-      break;
-      
-      case '\b': ///< Back space is pressed. Erase the current character with space and back up one character.
-      *(para->ptr.msg+pointer)=' ';
-      lcd->write(*(para->ptr.msg+pointer));
-      if (pointer>0)
-      {
-        pointer--;
-      }
-      setCursor(pointer+para->col,para->row);
-      break;
-      
-      case phi_prompt_right: ///< Right is pressed
-      if (pointer<(para->width)-1)
-      {
-        pointer++;
-        setCursor(pointer+para->col,para->row);
-      }
-      else
-      {
-        noCursor();
-        return (-4);
-      }
-      break;
-      
-      case phi_prompt_enter: ///< Enter is pressed
-      case '\n': ///< New line is received
       noCursor();
-      return(1);
-      break;
-      
-      case phi_prompt_escape: ///< Escape is pressed
+      phi_prompt_finish(task,-3);
+    }
+    break;
+    
+    case '\b': ///< Back space is pressed. Erase the current character with space and back up one character.
+    *(para->ptr.msg+task->pointer)=' ';
+    phi_prompt_write(*(para->ptr.msg+task->pointer));
+    if (task->pointer>0)
+    {
+      task->pointer--;
+    }
+    place_cursor(task->pointer+para->col,para->row);
+    break;
+    
+    case phi_prompt_right: ///< Right is pressed
+    if (task->pointer<(para->width)-1)
+    {
+      task->pointer++;
+      place_cursor(task->pointer+para->col,para->row);
+    }
+    else
+    {
       noCursor();
-      return (-1);
-      break;
-      
-      default: ///< Other keys were pressed. Accept only number keys.
-      if ((temp1>='0')&&(temp1<='9'))
+      phi_prompt_finish(task,-4);
+    }
+    break;
+    
+    case phi_prompt_enter: ///< Enter is pressed
+    case '\n': ///< New line is received
+    noCursor();
+    phi_prompt_finish(task,1);
+    break;
+    
+    case phi_prompt_escape: ///< Escape is pressed
+    noCursor();
+    phi_prompt_finish(task,-1);
+    break;
+    
+    default: ///< Other keys were pressed. Accept only number keys.
+    if ((key>='0')&&(key<='9'))
+    {
+      *(para->ptr.msg+task->pointer)=key;
+      phi_prompt_write(*(para->ptr.msg+task->pointer));
+      if (task->pointer<(para->width)-1)
       {
-        *(para->ptr.msg+pointer)=temp1;
-        lcd->write(*(para->ptr.msg+pointer));
-        if (pointer<(para->width)-1)
-        {
-          pointer++;
-        }
-        setCursor(pointer+para->col,para->row);
+        task->pointer++;
       }
-      break;
+      place_cursor(task->pointer+para->col,para->row);
     }
+    break;
   }
 }
 
 /**
  * \details Displays a text area using message stored in the SRAM.
  * \param para This is the phi_prompt struct to carry information between callers and functions.
- * It traps execution. It monitors the key pad input and changes message position with up and down keys.
+ * It traps execution. It monitors the key pad input and changes message position with up and down keys. Use text_area_begin() and phi_prompt_poll() if you can't afford that.
  * When the user presses left and right keys, the message scrolls up or down one page, which is 2 lines if you display a 3-line message or 3 lines if you display a 4-line message.
  * If the user presses 1-9 number keys, the function returns these numbers in ASCII for simple list select functions.
  * \return '1'-'9' if the user presses one of these keys. Enter was pressed (1), Escape was pressed (-1).
  */
 int text_area(phi_prompt_struct *para)
 {
-  byte columns=para->step.c_arr[1], rows=para->step.c_arr[0], ch;
+  phi_prompt_task task;
+  text_area_begin(&task,para);
+  return run_task(&task);
+}
+
+/**
+ * \details Starts text_area without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the text area between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See text_area().
+ */
+void text_area_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_text_area;
   long_msg_lcd(para);
-  while(true)
+}
+
+/**
+ * \details Handles a key for text_area and text_area_P. The two only differ in the functions that seek lines and render the message.
+ */
+static void text_area_key(phi_prompt_task *task, int key)
+{
+  phi_prompt_struct *para=task->para;
+  boolean in_progmem=(task->widget==phi_prompt_text_area_P);
+  switch (key)
   {
-    byte temp1=wait_on_escape(50);
-    switch (temp1)
-    {
-      case phi_prompt_up:
-      prev_line(para);
-      long_msg_lcd(para);
-      break;
-      
-      case phi_prompt_down:
-      next_line(para);
-      long_msg_lcd(para);
-      break;
+    case phi_prompt_up:
+    if (in_progmem) prev_line_P(para);
+    else text_prev_line(para);
+    break;
+    
+    case phi_prompt_down:
+    if (in_progmem) next_line_P(para);
+    else text_next_line(para);
+    break;
 
-      case phi_prompt_left: ///< Left is pressed. Scroll up one page, which is total_row-1 lines.
-      for (byte i=0;i<para->step.c_arr[0]-1;i++) prev_line(para);
-      long_msg_lcd(para);
-      break;
-      
-      case phi_prompt_right: ///< Right is pressed.  Scroll down one page, which is total_row-1 lines.
-      for (byte i=0;i<para->step.c_arr[0]-1;i++) next_line(para);
-      long_msg_lcd(para);
-      break;
-      
-      case phi_prompt_enter: ///< Enter is pressed
-      return(1);
-      break;
-      
-      case phi_prompt_escape: ///< Escape is pressed
-      return (-1);
-      break;
-      
-      default:
-      if ((temp1>='1')&&(temp1<='9')) return (temp1); ///< Returns numbers for simple select lists.
-      break;
+    case phi_prompt_left: ///< Left is pressed. Scroll up one page, which is total_row-1 lines.
+    for (byte i=0;i<para->step.c_arr[0]-1;i++)
+    {
+      if (in_progmem) prev_line_P(para);
+      else text_prev_line(para);
+    }
+    break;
+    
+    case phi_prompt_right: ///< Right is pressed.  Scroll down one page, which is total_row-1 lines.
+    for (byte i=0;i<para->step.c_arr[0]-1;i++)
+    {
+      if (in_progmem) next_line_P(para);
+      else text_next_line(para);
     }
+    break;
+    
+    case phi_prompt_enter: ///< Enter is pressed
+    phi_prompt_finish(task,1);
+    return;
+    
+    case phi_prompt_escape: ///< Escape is pressed
+    phi_prompt_finish(task,-1);
+    return;
+    
+    default:
+    if ((key>='1')&&(key<='9')) phi_prompt_finish(task,key); ///< Returns numbers for simple select lists.
+    return;
   }
+  if (in_progmem) long_msg_lcd_P(para);
+  else text_long_msg(para);
 }
 
 /**
  * \details Displays a text area using message stored in PROGMEM.
  * \param para This is the phi_prompt struct to carry information between callers and functions.
- * It traps execution. It monitors the key pad input and changes message position with up and down keys.
+ * It traps execution. It monitors the key pad input and changes message position with up and down keys. Use text_area_P_begin() and phi_prompt_poll() if you can't afford that.
  * When the user presses left and right keys, the message scrolls up or down one page, which is 2 lines if you display a 3-line message or 3 lines if you display a 4-line message.
  * If the user presses 1-9 number keys, the function returns these numbers in ASCII for simple list select functions.
  * \return '1'-'9' if the user presses one of these keys. Enter was pressed (1), Escape was pressed (-1).
  */
 int text_area_P(phi_prompt_struct *para) // Displays a text area using message stored in the PROGMEM
 {
-  byte columns=para->step.c_arr[1], rows=para->step.c_arr[0], ch;
-  long_msg_lcd_P(para);
-  while(true)
-  {
-    byte temp1=wait_on_escape(50);
-    switch (temp1)
-    {
-      case phi_prompt_up:
-      prev_line_P(para);
-      long_msg_lcd_P(para);
-      break;
-      
-      case phi_prompt_down:
-      next_line_P(para);
-      long_msg_lcd_P(para);
-      break;
+  phi_prompt_task task;
+  text_area_P_begin(&task,para);
+  return run_task(&task);
+}
 
-      case phi_prompt_left: ///< Left is pressed. Scroll up one page, which is total_row-1 lines.
-      for (byte i=0;i<para->step.c_arr[0]-1;i++) prev_line_P(para);
-      long_msg_lcd_P(para);
-      break;
-      
-      case phi_prompt_right: ///< Right is pressed.  Scroll down one page, which is total_row-1 lines.
-      for (byte i=0;i<para->step.c_arr[0]-1;i++) next_line_P(para);
-      long_msg_lcd_P(para);
-      break;
-      
-      case phi_prompt_enter: ///< Enter is pressed
-      return(1);
-      break;
-      
-      case phi_prompt_escape: ///< Escape is pressed
-      return (-1);
-      break;
-      
-      default:
-      if ((temp1>='1')&&(temp1<='9')) return (temp1); ///< Returns numbers for simple select lists.
-      break;
-    }
-  }
+/**
+ * \details Starts text_area_P without trapping. Call phi_prompt_poll() with the same task until it returns true, then read the return value with phi_prompt_result().
+ * \param task This holds the state of the text area between calls to phi_prompt_poll().
+ * \param para This is the phi_prompt struct to carry information between callers and functions. See text_area_P().
+ */
+void text_area_P_begin(phi_prompt_task *task, phi_prompt_struct *para)
+{
+  task->context=ctx;
+  task->para=para;
+  task->widget=phi_prompt_text_area_P;
+  long_msg_lcd_P(para);
 }
 
 /**
@@ -1397,9 +3075,10 @@ int yn_dialog(char msg[])
 // Use the yn_list struct to display the message as a long message to enable multiple line question.
   yn_list.ptr.msg=msg; // Assign the address of the text string to the pointer.
   yn_list.low.i=0; // Default text starting position. 0 is highly recommended.
-  yn_list.high.i=((sizeof(msg)-1)>lcd_w*lcd_h-10)?lcd_w*lcd_h-10:(sizeof(msg)-1); // Position of the last character in the text string, which is size of the string - 1.
-  yn_list.step.c_arr[0]=lcd_h; // row
-  yn_list.step.c_arr[1]=lcd_w; // column
+  int last=strlen(msg)-1; // Position of the last character in the text string, which is length of the string - 1.
+  yn_list.high.i=(last>ctx->lcd_w*ctx->lcd_h-10)?ctx->lcd_w*ctx->lcd_h-10:last;
+  yn_list.step.c_arr[0]=ctx->lcd_h; // row
+  yn_list.step.c_arr[1]=ctx->lcd_w; // column
   yn_list.col=0; // Display the text area starting at column 0
   yn_list.row=0; // Display the text area starting at row 0
   yn_list.option=0; // Option 0, display classic message, option 1, display message with scroll bar on right.
@@ -1410,43 +3089,56 @@ int yn_dialog(char msg[])
   yn_list.low.i=0; // Default item highlighted on the list is #0, the first item on the list.
   yn_list.high.i=1; // Last item on the list is size of the list - 1.
   yn_list.width=9; // Length in characters of the longest list item, for screen update purpose.
-  yn_list.col=lcd_w-9; // Display the list a column to make it right-alighed
-  yn_list.row=lcd_h-1; // Display the list at a row to make it bottom-alighed
+  yn_list.col=ctx->lcd_w-9; // Display the list a column to make it right-alighed
+  yn_list.row=ctx->lcd_h-1; // Display the list at a row to make it bottom-alighed
   yn_list.step.c_arr[0]=1; // 1 row
   yn_list.step.c_arr[1]=1; // 1 column
   yn_list.option=0; // Option 3 is an indexed list for clarity. Option 0, display classic list, option 1, display MXN list, option 2, display list with index, option 3, display list with index2.
 
   if (select_list(&yn_list)!=-1) return yn_list.low.i; //If the user didn't press escape (return -1) then update the user choice with the value in myListInput.low.
+  return -1;
 }
 
 /**
  * \details Displays a short message with OK.
  * \param msg This is the message to be displayed with the OK button.
- * It traps execution. It monitors the key pad input and returns if any key is pressed.
+ * It traps execution. It monitors the key pad input and returns if any key is pressed. Use ok_dialog_begin() and phi_prompt_poll() if you can't afford that.
  * The function auto scales to fit on any LCD.
- * \return It returns no value but for compatibility it is defined to return integer.
+ * \return It returns 1 after a key is pressed. It is defined to return integer for compatibility.
  */
 int ok_dialog(char msg[])
 {
+  phi_prompt_task task;
+  ok_dialog_begin(&task,msg);
+  return run_task(&task);
+}
+
+/**
+ * \details Starts ok_dialog without trapping. Call phi_prompt_poll() with the same task until it returns true.
+ * \param task This holds the state of the dialog between calls to phi_prompt_poll().
+ * \param msg This is the message to be displayed with the OK button.
+ */
+void ok_dialog_begin(phi_prompt_task *task, char msg[])
+{
+  task->context=ctx;
   phi_prompt_struct yn_list;
   
+  task->para=0;
+  task->widget=phi_prompt_ok_dialog;
   clear(); // Clear the lcd.
 // Use the yn_list struct to display the message as a long message to enable multiple line question.
   yn_list.ptr.msg=msg; // Assign the address of the text string to the pointer.
   yn_list.low.i=0; // Default text starting position. 0 is highly recommended.
-  yn_list.high.i=((sizeof(msg)-1)>lcd_w*lcd_h-5)?lcd_w*lcd_h-5:(sizeof(msg)-1); // Position of the last character in the text string, which is size of the string - 1.
-  yn_list.step.c_arr[0]=lcd_h; // row
-  yn_list.step.c_arr[1]=lcd_w; // column
+  int last=strlen(msg)-1; // Position of the last character in the text string, which is length of the string - 1.
+  yn_list.high.i=(last>ctx->lcd_w*ctx->lcd_h-5)?ctx->lcd_w*ctx->lcd_h-5:last;
+  yn_list.step.c_arr[0]=ctx->lcd_h; // row
+  yn_list.step.c_arr[1]=ctx->lcd_w; // column
   yn_list.col=0; // Display the text area starting at column 0
   yn_list.row=0; // Display the text area starting at row 0
   yn_list.option=0; // Option 0, display classic message, option 1, display message with scroll bar on right.
 
   long_msg_lcd(&yn_list);
 
-  setCursor((lcd_w-4),lcd_h-1);
-  lcd->print(">OK<");
-  
-  while(wait_on_escape(500)==0)
-  {
-  }
+  place_cursor((ctx->lcd_w-4),ctx->lcd_h-1);
+  phi_prompt_print(">OK<");
 }
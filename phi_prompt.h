@@ -23,6 +23,8 @@ This resulted in compilation errors such as "'prog_char' does not name a type".
 
 //The following are switches to certain functions. Comment them out if you don't want a particular function to save program space for larger projects
 //#define scrolling // This turns on auto strolling on list items and includes scrolling text library function.
+//#define phi_prompt_stats // This counts what each context sends to its display in a phi_prompt_counters struct and lets a trace hook see every byte sent. Leave it out to save the SRAM, flash and time it takes.
+//#define phi_prompt_timer2_keys // This scans keypads from a Timer2 interrupt so key presses are queued even while the display is busy. Timer2 is then not available for tone() or PWM on its pins. Only for keypads on direct pins, not I2C or serial ones.
 // Render list option bits
 #define phi_prompt_arrow_dot B00000001      ///< List display option for using arrow/dot before a list item.
 #define phi_prompt_index_list B00000010     ///< List display option for using an index list such as 12*4 for 4 total items and 3 is highlighted.
@@ -33,6 +35,8 @@ This resulted in compilation errors such as "'prog_char' does not name a type".
 #define phi_prompt_scroll_bar B01000000     ///< List display option for using a scroll bar on the right.
 #define phi_prompt_invert_text B10000000    ///< List display option for using inverted text. Only some modified version of the library uses it.
 #define phi_prompt_list_in_SRAM 0x100       ///< List display option for using a list that is stored in SRAM instead of in PROGMEM.
+#define phi_prompt_list_items 0x200         ///< List display option for using a list of phi_prompt_list_item in PROGMEM, which carries the length of each item so rendering doesn't scan the items.
+#define phi_prompt_list_callback 0x400      ///< List display option for using a phi_prompt_list_source that fetches items through a callback, such as from SD or EEPROM. Current and last items are then in low.l and high.l.
 
 // Internal function key codes
 #define total_function_keys 6       ///< Total number of function keys. At the moment, only 6 functions exist: up/down/left/right/enter/escape
@@ -44,6 +48,40 @@ This resulted in compilation errors such as "'prog_char' does not name a type".
 #define phi_prompt_enter 5          ///< Function key code for enter
 #define phi_prompt_escape 6         ///< Function key code for escape
 
+// Display command queue
+#define phi_prompt_queue_size 40        ///< Number of bytes the outbound display queue holds. Each takes 2 bytes of SRAM.
+#define phi_prompt_clear_settle 2       ///< Milliseconds the display needs after a clear command before it takes more bytes.
+#define phi_prompt_command_settle 1     ///< Milliseconds the display needs after other commands such as moving the cursor.
+#define phi_prompt_queued_command 0x80  ///< Queue flag marking a command byte. The lower bits hold the settle time in ms.
+#define phi_prompt_queued_settle 0x7F   ///< Queue flag bits holding the settle time in ms.
+#define phi_prompt_trace_key 0x40       ///< Trace hook flags for a key press taken by wait_on_escape(). Display bytes never carry it since settle times are a few ms.
+#define phi_prompt_burst_size 20        ///< Most characters handed to the display driver in one write.
+#define phi_prompt_gap_fill 2           ///< Most unchanged cells phi_prompt_flush() sends again to reach the next changed cell instead of moving the cursor, which takes two bytes and a command.
+
+// Key queue
+#define phi_prompt_key_queue_size 8     ///< Number of key presses that can wait to be handled. One less than this fit at a time.
+#define phi_prompt_key_scan_rate 200    ///< Times per second Timer2 scans the keypads when phi_prompt_timer2_keys is defined.
+#define phi_prompt_accel_repeats 10     ///< Repeats of a held key after which input_integer steps 10 times as far, and after twice as many 100 times as far.
+#define phi_prompt_tap_time 1000        ///< Milliseconds after the last multi-tap key press that input_panel accepts the character and moves on.
+
+// Widgets that run as tasks. These are stored in phi_prompt_task.widget while the widget runs.
+#define phi_prompt_select_list 1    ///< Task is running select_list.
+#define phi_prompt_input_integer 2  ///< Task is running input_integer.
+#define phi_prompt_input_panel 3    ///< Task is running input_panel.
+#define phi_prompt_input_number 4   ///< Task is running input_number.
+#define phi_prompt_text_area 5      ///< Task is running text_area.
+#define phi_prompt_text_area_P 6    ///< Task is running text_area_P.
+#define phi_prompt_ok_dialog 7      ///< Task is running ok_dialog.
+#define phi_prompt_input_long 8     ///< Task is running input_long.
+#define phi_prompt_input_fixed 9    ///< Task is running input_fixed.
+#define phi_prompt_widgets 9        ///< Highest widget id.
+#define phi_prompt_scroll_time 500  ///< Milliseconds an auto scrolling list item stays at each position. The highlighted item is the only thing redrawn between positions.
+#define phi_prompt_fixed_digits 9   ///< Most digits input_fixed and input_float edit, before and after the decimal point together, so ten to that many fits a long.
+
+// Dashboard field types
+#define phi_prompt_field_int 0      ///< Dashboard field bound to an int.
+#define phi_prompt_field_long 1     ///< Dashboard field bound to a long.
+
 #define HD44780_lcd 0               ///< Type of display is HD44780
 #define KS0108_lcd 1                ///< Type of display is KS0108 GLCD
 #define serial_lcd 2                ///< Type of display is serial lcd
@@ -57,14 +95,46 @@ This resulted in compilation errors such as "'prog_char' does not name a type".
 #include <SoftwareSerial.h>
 #include <avr/pgmspace.h>
 #include <phi_interfaces.h>
+#include <phi_prompt_display.h>
+#include <phi_prompt_format.h>
+
+struct phi_prompt_list_item ///< This describes one list item in PROGMEM together with its length. Build arrays of these with phi_prompt_item().
+{
+  PGM_P text;               // The item, stored in PROGMEM.
+  byte len;                 // Length of the item without the terminating 0.
+};
+
+/**
+ * \details Builds a list item descriptor at compile time, with the length taken from the size of the array.
+ * Use it on items declared as char arrays in PROGMEM, such as const char item00[] PROGMEM="Apple";
+ * then const phi_prompt_list_item menu[] PROGMEM={phi_prompt_item(item00), phi_prompt_item(item01)};
+ * and set para.ptr.items=menu; para.option|=phi_prompt_list_items;
+ */
+template <size_t N> constexpr phi_prompt_list_item phi_prompt_item(const char (&text)[N])
+{
+  static_assert((N>0)&&(N<=256), "List items are limited to 255 characters.");
+  return phi_prompt_list_item{text, (byte)(N-1)};
+}
+
+struct phi_prompt_list_source ///< This fetches list items through a callback so a list can hold more items than fit in memory. It caches the items on screen.
+{
+  int (*fetch)(long item, int offset, char *dst, byte len); // Copies up to len characters of item starting at character offset to dst, without terminating 0, and returns the length of the whole item.
+  char *cache;              // Buffer of items on screen times list width characters.
+  int *lengths;             // Buffer of items on screen lengths.
+  long first;               // First item in the cache. Set it to -1 after the items change so they are fetched again.
+  byte count;               // Number of items in the cache.
+};
 
 union buffer_pointer    ///< This defines a union to store various pointer types.
 {
   int *i_buffer;
+  long *l_buffer;
   float * f_buffer;
   char ** list;
   char* msg;
   PGM_P msg_P;
+  const phi_prompt_list_item *items;
+  phi_prompt_list_source *source;
 };
 
 union four_bytes        ///< This defines a union to store various data.
@@ -90,44 +160,213 @@ struct phi_prompt_struct    ///< This struct is used in exchange information bet
   void (*update_function)(phi_prompt_struct *); // This is not being used in this version but reserved for future releases.
 }; //22 bytes
 
-void init_phi_prompt(SoftwareSerial *l, multiple_button_input *k[], char ** fk, int w, int h, char i); ///< This is the library initialization routine.
+struct phi_prompt_key_event ///< This is a key press waiting in the key queue.
+{
+  byte key;                 // Key as the keypad reported it, before translation into function keys.
+  unsigned long time;       // millis() when the key press was sensed.
+  boolean held;             // Set when the keypad reported the press as a repeat of a key held down.
+};
+
+struct phi_prompt_field ///< This binds an int or long variable to a place on a dashboard. Initialize the first seven members and leave the rest 0.
+{
+  void *value;              // Points to the variable.
+  byte type;                // phi_prompt_field_int or phi_prompt_field_long.
+  byte col;                 // Which column the field starts.
+  byte row;                 // Which row the field is on.
+  byte width;               // Number of characters the field takes.
+  byte decimals;            // Digits after the decimal point for fixed-point values, such as 1 to show 215 as 21.5. 0 for whole numbers.
+  byte option;              // 0: space pad right, 1: zero pad left, 2: space pad left.
+  long shown;               // Value on screen.
+  boolean valid;            // Set once the field is on screen. Cleared by phi_prompt_dashboard_invalidate().
+};
+
+struct phi_prompt_dashboard ///< This is a screen of fields that phi_prompt_dashboard_update() keeps up to date.
+{
+  phi_prompt_field *fields; // Array of fields.
+  byte count;               // Number of fields.
+  byte budget_bytes;        // Most bytes one update may queue for the display, 0 for no limit.
+  unsigned int budget_us;   // Most microseconds one update may take, 0 for no limit.
+  byte next;                // Field the next update starts with, so fields left out by the budget go first next time.
+};
+
+struct phi_prompt_queued    ///< This is one byte waiting to go to the display.
+{
+  byte value;
+  byte flags;               // phi_prompt_queued_command for a command byte, plus ms the display needs to settle after it.
+};
+
+struct phi_prompt_counters  ///< These count what a context has done since init_phi_prompt() or phi_prompt_reset_stats(). Kept only with phi_prompt_stats defined.
+{
+  unsigned long bytes;      // Bytes handed to the display driver, a command counting as one.
+  unsigned long commands;   // Commands handed to the display driver, including cursor moves.
+  unsigned int set_cursor;  // Cursor placements by setCursor() and the renderers.
+  unsigned int clears;      // clear() calls.
+  unsigned int create_chars; // Custom characters loaded into CGRAM by createChar() or phi_prompt_glyph().
+  unsigned long settle_ms;  // Time the display queue was held for commands to settle, which is what delay() used to be for.
+  unsigned int renders[phi_prompt_widgets+1]; // Flushes that sent anything, by the id of the widget running, 0 outside widgets.
+  unsigned long idle_us;    // Time wait_on_escape() spent waiting for keys.
+  unsigned long busy_us;    // Time between calls to wait_on_escape(), spent handling keys and rendering.
+};
+
+struct phi_prompt_context   ///< This holds everything one user interface needs: its display, keypads, display shadow and queues. Bind one with phi_prompt_bind() to run a second display and keypad from the same sketch.
+{
+  phi_prompt_context();
+  phi_prompt_display *lcd;                    // Display driver all output goes through.
+  phi_prompt_serial_lcd serial_display;       // Driver wrapping the serial port passed to init_phi_prompt() or its serial LCD variants.
+  int lcd_w;                                  // Width of the LCD in number of characters.
+  int lcd_h;                                  // Height of the LCD in number of characters.
+  char indicator;                             // Character marking the highlighted item in lists/menus.
+  char bullet;                                // Character marking the other items in lists/menus.
+  char **function_keys;                       // Array of pointers to zero-terminated strings of function keys.
+  byte key_table[128];                        // Function of each of the 256 key codes, one nibble per key: 0 for none or 1 plus the function's offset from function_key_code_base.
+  multiple_button_input **mbi_ptr;            // Array of pointers to the keypads, terminated by 0.
+  byte lcd_type;                              // Type of lcd reported by the display driver, such as HD44780 or serial lcd.
+  boolean key_repeat_enable;                  // Enables acceleration of input_integer while a key is held.
+  boolean multi_tap_enable;                   // Enables multi-tap in input_panel.
+  PGM_P tap_keys;                             // Keys that multi-tap.
+  const char * const *tap_charsets;           // Characters each multi-tap key cycles through.
+  phi_prompt_struct shared_struct;            // Struct shared among simple function calls.
+  char *shadow;                               // Shadow of the display contents, lcd_w*lcd_h characters row by row.
+  byte *shadow_dirty;                         // One bit per shadow cell, set when the cell has changed since the last flush.
+  byte *shadow_unknown;                       // One bit per shadow cell, set when what the display shows in the cell is not known.
+  int shadow_cells;                           // Number of cells the shadow buffers were allocated for.
+  byte cursor_col;                            // Column where the next character goes, as set by setCursor().
+  byte cursor_row;                            // Row where the next character goes, as set by setCursor().
+  byte hw_address;                            // Display's DDRAM address counter. 255 means unknown.
+  byte display_control;                       // Last display on/off control command sent. 0 means unknown.
+  PGM_P glyph_ids[8];                         // Glyph loaded in each CGRAM slot by phi_prompt_glyph(), 0 for none.
+  byte glyph_lru[8];                          // CGRAM slots from least to most recently used.
+  byte glyph_pinned;                          // One bit per CGRAM slot loaded with createChar().
+  phi_prompt_queued queue[phi_prompt_queue_size]; // Outbound queue of bytes for the display, drained by phi_prompt_service().
+  unsigned int queue_total;                   // Counts every byte queued for the display.
+  byte queue_head;                            // Where the next queued byte goes.
+  byte queue_tail;                            // Next byte to send.
+  byte queue_count;                           // Number of bytes queued.
+  unsigned long queue_ready;                  // Time in micros() when the display is ready for the next byte.
+  byte settle_pending;                        // Settle time in ms of the last command, which starts once the driver has sent it.
+  volatile phi_prompt_key_event key_events[phi_prompt_key_queue_size]; // Key presses filled by phi_prompt_scan_keys() and emptied by wait_on_escape().
+  volatile byte key_head;                     // Where the next key press goes.
+  volatile byte key_tail;                     // Oldest key press not yet taken.
+  byte key_repeats;                           // Repeats of the key being held, as the keypad reported them.
+  byte held_key;                              // Last key taken off the key queue.
+  int *line_starts;                           // Caller's buffer for the line index of text areas. See set_line_index().
+  int line_capacity;                          // Number of lines the line index buffer holds.
+  int line_count;                             // Number of lines in the line index. 0 means there is no usable index.
+  int line_length;                            // Length of the indexed message.
+  int line_current;                           // Line the last seek ended on.
+  const char *line_msg;                       // Message the line index was built for.
+  byte line_columns;                          // Number of columns the line index was built for.
+  boolean line_in_progmem;                    // Set when the indexed message is in PROGMEM.
+  char *scratch;                              // Arena renderers format a line of text in, allocated by init_phi_prompt() from the display width.
+  int scratch_size;                           // Number of bytes in the scratch arena.
+  int scratch_used;                           // Number of bytes of the scratch arena taken.
+  int scratch_peak;                           // Most bytes of the scratch arena taken at once since init_phi_prompt().
+  phi_prompt_context *next;                   // Next context initialized, so keys are scanned and queues serviced for all of them.
+#ifdef phi_prompt_stats
+  phi_prompt_counters stats;                  // What this context has done. See phi_prompt_read_stats().
+  byte widget;                                // Widget phi_prompt_poll() is running, 0 for none.
+  unsigned long stats_mark;                   // micros() when wait_on_escape() last returned, 0 before it first has.
+  void (*trace)(byte value, byte flags);      // Called for every byte handed to the display driver and every key taken. See phi_prompt_set_trace().
+  Print *record_out;                          // Where phi_prompt_record() writes the trace, 0 when not recording.
+  void (*record_previous)(byte value, byte flags); // Trace hook set before phi_prompt_record() took it over, put back when recording stops.
+  unsigned long record_time;                  // micros() of the last record written.
+#endif
+};
+
+struct phi_prompt_task  ///< This holds the state of a widget between calls to phi_prompt_poll() so the widget doesn't trap execution.
+{
+  phi_prompt_struct *para;  // The struct the widget was started with.
+  byte widget;              // Which widget is running, such as phi_prompt_select_list. 0 once the widget has finished.
+  int result;               // What the blocking version of the widget returns. Valid once the widget has finished.
+  long number;              // Value being edited in input_integer and input_long, or its digits without the sign in input_fixed.
+  byte pointer;             // Position of the cursor in input_panel, input_number and input_fixed.
+  byte render;              // Set when select_list needs to render again without a key press, such as to auto scroll an item, or when input_integer has a value to show.
+  unsigned long tick;       // Auto scroll position select_list last rendered, in units of phi_prompt_scroll_time, or when input_panel last had a multi-tap key press.
+  char tap_key;             // Multi-tap key input_panel is cycling the characters of, 0 for none.
+  byte taps;                // Number of taps of tap_key so far, less one.
+  boolean negative;         // Sign of the value input_fixed is editing, kept apart from number so that -0.5 keeps its sign while its digits are zero.
+  phi_prompt_context *context; // Context the widget was started in. phi_prompt_poll() binds it while the widget runs.
+};
+
+void init_phi_prompt(SoftwareSerial *l, multiple_button_input *k[], char ** fk, int w, int h, char i); ///< This is the library initialization routine for a serial LCD on a SoftwareSerial port.
+void init_phi_prompt_hardware_serial(HardwareSerial *l, multiple_button_input *k[], char ** fk, int w, int h, char i, long baud=0); ///< This is the library initialization routine for a serial LCD on a hardware serial port, optionally switching it to a faster baud rate.
+void init_phi_prompt_stream(Stream *l, multiple_button_input *k[], char ** fk, int w, int h, char i); ///< This is the library initialization routine for a serial LCD on any other serial port, such as AltSoftSerial or a USB serial port.
+void init_phi_prompt_driver(phi_prompt_display *d, multiple_button_input *k[], char ** fk, int w, int h, char i); ///< This is the library initialization routine for any display driver, such as phi_prompt_parallel_lcd, phi_prompt_i2c_lcd or phi_prompt_mirror_display.
+phi_prompt_context *phi_prompt_bind(phi_prompt_context *context); ///< Makes all functions work on another display and keypads. Returns the context bound before.
+int phi_prompt_scratch_peak(int *size=0); ///< Returns the most bytes of the scratch arena renderers have used at once since init, and its size in *size.
 void set_indicator(char i);                         ///< This sets the indicator used in lists/menus. The highlighted item is indicated by this character. Use '~' for a right arrow.
 void set_bullet(char i);                            ///< This sets the bullet used in lists/menus. The non-highlighted items are indicated by this character. Use '\xA5' for a center dot.
 void set_repeat_time(int i);                        ///< This sets key repeat time, how often a key repeats when held. It uses multiple_button_input.set_repeat()
-void enable_key_repeat(boolean i);                  ///< Sets whether to enable key repeat on inputs. This is not used in this version. A future version may make use of it.
-void enable_multi_tap(boolean i);                   ///< Sets whether to enable multi-tap on inputs. This is not used in this version. A future version may make use of it.
+void enable_key_repeat(boolean i);                  ///< Sets whether holding a key down accelerates input_integer. It is enabled by default.
+void enable_multi_tap(boolean i);                   ///< Sets whether number keys type letters in input_panel by tapping them, as on a phone.
+void set_multi_tap_table(PGM_P keys, const char * const *charsets); ///< Sets which keys multi-tap and the characters each key cycles through, all in PROGMEM.
 char inc(char ch, phi_prompt_struct *para);         ///< Increment character ch according to options set in para.
 char dec(char ch, phi_prompt_struct *para);         ///< Decrement character ch according to options set in para.
 char phi_prompt_translate(char key);                ///< This translates keypad input in case the key press is a function key. If the key press is not a function key, it returns without translation.
+void set_function_key(char key, byte function);     ///< Makes key act as a function key such as phi_prompt_up, or as a plain key with function 0.
 void scroll_text(char * src, char * dst, char dst_len, short pos);  ///< This scrolls a string into and out of a narrow window, for displaying long message on a narrow line.
 void scroll_text_P(PGM_P src, char * dst, char dst_len, short pos); ///< This scrolls a string stored in PROGMEM into and out of a window, for displaying long message on a narrow line.
 void msg_lcd(char* msg_lined);                      ///< This is a quick and easy way to display a string in the PROGMEM to the LCD.
+void set_line_index(int *buffer, int size);         ///< Gives text areas a buffer to index line starts in, so paging through long messages doesn't scan them.
 void prev_line(phi_prompt_struct* para);            ///< Seeks previous line in a long message stored in SRAM.
 void next_line(phi_prompt_struct* para);            ///< Seeks next line in a long message stored in SRAM.
 void prev_line_P(phi_prompt_struct* para);          ///< Seeks previous line in a long message stored in PROGMEM.
 void next_line_P(phi_prompt_struct* para);          ///< Seeks previous line in a long message stored in PROGMEM.
 void center_text(char * src);                       ///< This function displays a short message centered with the display size.
 void scroll_bar_v(byte p, byte c, byte r, byte h);  ///< Displays a scroll bar at column/row with height and percentage.
+void bar_gauge_h(int value, int low, int high, byte column, byte row, byte width); ///< Displays a horizontal bar gauge at column/row with 5 steps per character.
+byte phi_prompt_dashboard_update(phi_prompt_dashboard *board); ///< Redraws the fields of a dashboard whose variables changed, within the budget. Returns the number of changed fields left for the next update.
+void phi_prompt_dashboard_invalidate(phi_prompt_dashboard *board); ///< Makes the next updates redraw every field of a dashboard, such as after clear().
 void long_msg_lcd(phi_prompt_struct *para);         ///< Displays a static long message stored in SRAM that could span multiple lines.
 void long_msg_lcd_P(phi_prompt_struct *para);       ///< Displays a static long message stored in PROGMEM that could span multiple lines.
 byte render_list(phi_prompt_struct *para);
+void phi_prompt_write(byte ch);                     ///< Writes a character into the display shadow at the cursor. Only changed cells are sent on the next flush.
+void phi_prompt_print(const char * msg);            ///< Writes a string into the display shadow at the cursor.
+void phi_prompt_flush();                            ///< Sends the changed cells of the display shadow to the display.
+void phi_prompt_invalidate();                       ///< Forgets what the display shows. Call after writing to the display directly with lcd.print().
+int phi_prompt_service();                           ///< Sends queued bytes to the display when it is ready for them. Never waits. Returns bytes still queued.
+int phi_prompt_service_all();                       ///< Sends queued bytes to every display, one context after another. Never waits. Returns bytes still queued for all of them.
+#ifdef phi_prompt_stats
+phi_prompt_counters *phi_prompt_read_stats();       ///< Returns the counters of the bound context.
+void phi_prompt_reset_stats();                      ///< Zeroes the counters of the bound context.
+void phi_prompt_dump_stats(Print *p);               ///< Prints the counters of the bound context, one per line, such as to &Serial.
+void phi_prompt_set_trace(void (*hook)(byte value, byte flags)); ///< Sets a function called with every byte sent to the display of the bound context and every key it takes, 0 for none.
+void phi_prompt_record(Print *out, const char *session); ///< Writes a binary trace of the display bytes and keys of the bound context to out, such as an SD file, until called with out 0.
+#endif
 void clear();
-void setCursor(int posNum, int lineNum);
+void setCursor(int posNum, int lineNum); ///< Flushes and moves the display cursor, so lcd.print() can follow. Renderers place their text without a cursor command.
 void blink();
 void noBlink();
 void cursor();
 void noCursor(); 
-void createChar(uint8_t location, uint8_t charmap[]); 
+void createChar(uint8_t location, uint8_t charmap[]);
+byte phi_prompt_glyph(PGM_P glyph);                 ///< Loads a custom character from PROGMEM into CGRAM unless it is there already, and returns the character code to write for it.
 
+void phi_prompt_scan_keys();                        ///< Polls all keypads once and queues key presses. Only call it from an interrupt if every keypad reads pins directly, not I2C or serial.
 int wait_on_escape(int ref_time);                   ///< Returns key pressed or NO_KEY if time expires before any key was pressed. This does the key sensing and translation.
 
 int ok_dialog(char msg[]);                          ///< Displays an ok dialog
 int yn_dialog(char msg[]);                          ///< Displays a short message with yes/no options.
 int input_integer(phi_prompt_struct *para);         ///< Input integer on keypad with fixed step, upper and lower limits.
-int input_float(phi_prompt_struct *para);
+int input_long(phi_prompt_struct *para);            ///< Input long on keypad with fixed step, upper and lower limits in low.l, high.l and step.l.
+int input_fixed(phi_prompt_struct *para);           ///< Input a fixed point value digit by digit as a long scaled by the digits after the decimal point.
+int input_float(phi_prompt_struct *para);           ///< Input a float through input_fixed with cells before the decimal point, sign included, and digits after it in step.c_arr.
 int select_list(phi_prompt_struct *para);           ///< Displays a list/menu for the user to select. Display options for list: Option 0, display classic list, option 1, display 2X2 list, option 2, display list with index, option 3, display list with index2.
 int input_panel(phi_prompt_struct *para);           ///< Input character options for input panel: Option 0, default, option 1 include 0-9 as valid inputs.
 int input_number(phi_prompt_struct *para);          ///< Input number on keypad with decimal point and negative.
 int text_area(phi_prompt_struct *para);             ///< Displays a text area using message stored in the SRAM.
 int text_area_P(phi_prompt_struct *para);           ///< Displays a text area using message stored in PROGMEM.
 
+void select_list_begin(phi_prompt_task *task, phi_prompt_struct *para);    ///< Starts select_list as a task that phi_prompt_poll() runs without trapping.
+void input_integer_begin(phi_prompt_task *task, phi_prompt_struct *para);  ///< Starts input_integer as a task that phi_prompt_poll() runs without trapping.
+void input_long_begin(phi_prompt_task *task, phi_prompt_struct *para);     ///< Starts input_long as a task that phi_prompt_poll() runs without trapping.
+void input_fixed_begin(phi_prompt_task *task, phi_prompt_struct *para);    ///< Starts input_fixed as a task that phi_prompt_poll() runs without trapping.
+void input_panel_begin(phi_prompt_task *task, phi_prompt_struct *para);    ///< Starts input_panel as a task that phi_prompt_poll() runs without trapping.
+void input_number_begin(phi_prompt_task *task, phi_prompt_struct *para);   ///< Starts input_number as a task that phi_prompt_poll() runs without trapping.
+void text_area_begin(phi_prompt_task *task, phi_prompt_struct *para);      ///< Starts text_area as a task that phi_prompt_poll() runs without trapping.
+void text_area_P_begin(phi_prompt_task *task, phi_prompt_struct *para);    ///< Starts text_area_P as a task that phi_prompt_poll() runs without trapping.
+void ok_dialog_begin(phi_prompt_task *task, char msg[]);                   ///< Starts ok_dialog as a task that phi_prompt_poll() runs without trapping.
+boolean phi_prompt_poll(phi_prompt_task *task);     ///< Handles at most one key press and one display update of a task, then returns. Returns true once the widget has finished.
+int phi_prompt_result(phi_prompt_task *task);       ///< Returns what the blocking version of a finished widget returns.
+byte phi_prompt_poll_all(phi_prompt_task *tasks[], byte count); ///< Runs one step of each task in turn, each in its own context, and feeds every display. Returns the number of tasks still running.
+
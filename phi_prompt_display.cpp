@@ -0,0 +1,297 @@
+/*
+Display drivers for phi_prompt. See phi_prompt_display.h.
+*/
+
+#if ARDUINO < 100
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#include <Wire.h>
+#include <phi_prompt.h>
+
+/**
+ * \details Sends a run of characters one by one. Drivers that can send several characters in one transfer override this.
+ * \param buffer This points to the characters.
+ * \param size This is the number of characters.
+ */
+void phi_prompt_display::write(const byte *buffer, byte size)
+{
+  for (byte i=0;i<size;i++) write(buffer[i]);
+}
+
+byte phi_prompt_display::room()
+{
+  return 255;
+}
+
+boolean phi_prompt_display::idle()
+{
+  return true;
+}
+
+//Serial LCD
+const long phi_prompt_serlcd_bauds[]={2400,4800,9600,14400,19200,38400}; ///< Baud rates of serLCD codes phi_prompt_serlcd_baud_base and up.
+
+/**
+ * \details Sets up the driver for a serial LCD on a serial port.
+ * \param p This is the serial port, such as &LCD for a SoftwareSerial or &Serial1.
+ * \param b This is true for a port with a transmit buffer emptied by an interrupt, such as a HardwareSerial, so the library hands it only what fits and the CPU never waits on the wire.
+ * Leave it false for SoftwareSerial, which sends each byte before write() returns.
+ */
+phi_prompt_serial_lcd::phi_prompt_serial_lcd(Print *p, boolean b)
+{
+  port=p;
+  buffered=b;
+  capacity=0;
+}
+
+void phi_prompt_serial_lcd::command(byte cmd)
+{
+  port->write(0xFE); // Command flag
+  port->write(cmd);
+}
+
+void phi_prompt_serial_lcd::write(byte ch)
+{
+  port->write(ch);
+}
+
+void phi_prompt_serial_lcd::write(const byte *buffer, byte size)
+{
+  port->write(buffer,size);
+}
+
+byte phi_prompt_serial_lcd::type()
+{
+  return serial_lcd;
+}
+
+byte phi_prompt_serial_lcd::room()
+{
+  if (!buffered) return 255;
+  int n=port->availableForWrite();
+  if (n>capacity) capacity=n;
+  return (n>255)?255:n;
+}
+
+boolean phi_prompt_serial_lcd::idle()
+{
+  if (!buffered) return true;
+  int n=port->availableForWrite();
+  if (n>capacity) capacity=n;
+  return (n>=capacity);
+}
+
+/**
+ * \details Sends the serLCD command that switches the backpack to another baud rate. The backpack keeps the rate when powered off.
+ * \param baud This is the new rate, from 2400 to 38400.
+ * \return It returns false without sending anything if the backpack has no code for the rate.
+ */
+boolean phi_prompt_serial_lcd::set_baud(long baud)
+{
+  for (byte i=0;i<sizeof(phi_prompt_serlcd_bauds)/sizeof(phi_prompt_serlcd_bauds[0]);i++)
+  {
+    if (phi_prompt_serlcd_bauds[i]==baud)
+    {
+      port->write(phi_prompt_serlcd_special);
+      port->write(phi_prompt_serlcd_baud_base+i);
+      return true;
+    }
+  }
+  return false;
+}
+
+//Parallel HD44780
+phi_prompt_parallel_lcd::phi_prompt_parallel_lcd(byte rs, byte en, byte d4, byte d5, byte d6, byte d7)
+{
+  rs_pin=rs;
+  en_pin=en;
+  data_pins[0]=d4;
+  data_pins[1]=d5;
+  data_pins[2]=d6;
+  data_pins[3]=d7;
+}
+
+/**
+ * \details Initializes the controller in 4-bit mode following the HD44780 datasheet. This is the only place the driver waits in milliseconds.
+ */
+void phi_prompt_parallel_lcd::begin()
+{
+  pinMode(rs_pin,OUTPUT);
+  pinMode(en_pin,OUTPUT);
+  for (byte i=0;i<4;i++) pinMode(data_pins[i],OUTPUT);
+  digitalWrite(rs_pin,LOW);
+  digitalWrite(en_pin,LOW);
+  delay(50); // Power on
+  nibble(0x03); // The controller could be in 8-bit mode or half way through a 4-bit byte. Three of these get it into 8-bit mode.
+  delayMicroseconds(4500);
+  nibble(0x03);
+  delayMicroseconds(4500);
+  nibble(0x03);
+  delayMicroseconds(150);
+  nibble(0x02); // Now switch to 4-bit mode.
+  delayMicroseconds(100);
+  command(0x28); // 4-bit, 2 lines, 5x8 dots
+  command(0x0C); // Display on, no cursor
+  command(0x01); // Clear
+  delayMicroseconds(2000);
+  command(0x06); // Cursor moves right, no display shift
+}
+
+void phi_prompt_parallel_lcd::command(byte cmd)
+{
+  send(cmd,LOW);
+}
+
+void phi_prompt_parallel_lcd::write(byte ch)
+{
+  send(ch,HIGH);
+}
+
+byte phi_prompt_parallel_lcd::type()
+{
+  return HD44780_lcd;
+}
+
+/**
+ * \details Sends a byte as two nibbles and waits the 40us the controller needs for everything except clear and home. Those two are covered by the settle time of the command queue.
+ */
+void phi_prompt_parallel_lcd::send(byte value, byte mode)
+{
+  digitalWrite(rs_pin,mode);
+  nibble(value>>4);
+  nibble(value);
+  delayMicroseconds(40);
+}
+
+void phi_prompt_parallel_lcd::nibble(byte value)
+{
+  for (byte i=0;i<4;i++) digitalWrite(data_pins[i],(value>>i)&0x01);
+  digitalWrite(en_pin,HIGH); // Data is latched on the falling edge of E, which has to stay high for at least 450ns.
+  delayMicroseconds(1);
+  digitalWrite(en_pin,LOW);
+}
+
+//PCF8574 I2C backpack
+phi_prompt_i2c_lcd::phi_prompt_i2c_lcd(byte address)
+{
+  i2c_address=address;
+  backlight_bit=phi_prompt_i2c_backlight;
+}
+
+/**
+ * \details Initializes the controller in 4-bit mode following the HD44780 datasheet. This is the only place the driver waits in milliseconds.
+ */
+void phi_prompt_i2c_lcd::begin()
+{
+  byte init_nibbles[]={0x03, 0x03, 0x03, 0x02}; // See phi_prompt_parallel_lcd::begin()
+  delay(50); // Power on
+  for (byte i=0;i<4;i++)
+  {
+    Wire.beginTransmission(i2c_address);
+    Wire.write((init_nibbles[i]<<phi_prompt_i2c_data_shift)|phi_prompt_i2c_en|backlight_bit);
+    Wire.write((init_nibbles[i]<<phi_prompt_i2c_data_shift)|backlight_bit);
+    Wire.endTransmission();
+    delayMicroseconds(4500);
+  }
+  command(0x28); // 4-bit, 2 lines, 5x8 dots
+  command(0x0C); // Display on, no cursor
+  command(0x01); // Clear
+  delayMicroseconds(2000);
+  command(0x06); // Cursor moves right, no display shift
+}
+
+void phi_prompt_i2c_lcd::backlight(boolean on)
+{
+  backlight_bit=on?phi_prompt_i2c_backlight:0;
+  Wire.beginTransmission(i2c_address);
+  Wire.write(backlight_bit);
+  Wire.endTransmission();
+}
+
+void phi_prompt_i2c_lcd::command(byte cmd)
+{
+  send(&cmd,1,0);
+}
+
+void phi_prompt_i2c_lcd::write(byte ch)
+{
+  send(&ch,1,phi_prompt_i2c_rs);
+}
+
+void phi_prompt_i2c_lcd::write(const byte *buffer, byte size)
+{
+  send(buffer,size,phi_prompt_i2c_rs);
+}
+
+byte phi_prompt_i2c_lcd::type()
+{
+  return HD44780_lcd;
+}
+
+/**
+ * \details Sends bytes as nibbles with E pulsed high then low, packing up to phi_prompt_i2c_burst bytes into one I2C transmission.
+ * At 100kHz each I2C byte takes 90us, which is longer than the controller needs between writes, so no extra wait is needed.
+ */
+void phi_prompt_i2c_lcd::send(const byte *buffer, byte size, byte mode)
+{
+  while (size)
+  {
+    byte burst=(size>phi_prompt_i2c_burst)?phi_prompt_i2c_burst:size;
+    Wire.beginTransmission(i2c_address);
+    for (byte i=0;i<burst;i++)
+    {
+      byte high=((buffer[i]>>4)<<phi_prompt_i2c_data_shift)|mode|backlight_bit, low=((buffer[i]&0x0F)<<phi_prompt_i2c_data_shift)|mode|backlight_bit;
+      Wire.write(high|phi_prompt_i2c_en);
+      Wire.write(high);
+      Wire.write(low|phi_prompt_i2c_en);
+      Wire.write(low);
+    }
+    Wire.endTransmission();
+    buffer+=burst;
+    size-=burst;
+  }
+}
+
+//Mirror
+phi_prompt_mirror_display::phi_prompt_mirror_display(phi_prompt_display *a, phi_prompt_display *b)
+{
+  first=a;
+  second=b;
+}
+
+void phi_prompt_mirror_display::command(byte cmd)
+{
+  first->command(cmd);
+  second->command(cmd);
+}
+
+void phi_prompt_mirror_display::write(byte ch)
+{
+  first->write(ch);
+  second->write(ch);
+}
+
+void phi_prompt_mirror_display::write(const byte *buffer, byte size)
+{
+  first->write(buffer,size);
+  second->write(buffer,size);
+}
+
+byte phi_prompt_mirror_display::type()
+{
+  return first->type();
+}
+
+byte phi_prompt_mirror_display::room()
+{
+  byte a=first->room(), b=second->room();
+  return (a<b)?a:b;
+}
+
+boolean phi_prompt_mirror_display::idle()
+{
+  return first->idle()&&second->idle();
+}
@@ -0,0 +1,100 @@
+/*
+Display drivers for phi_prompt.
+Every display phi_prompt drives speaks the HD44780 instruction set. A driver only has to know how to get an instruction or a character to the controller:
+the serial LCD driver prefixes instructions with 0xFE, the parallel driver clocks nibbles on 4 data pins and the I2C driver clocks the same nibbles through a PCF8574 port expander.
+Create one of these, call its begin() and pass its address to init_phi_prompt_driver().
+For a serial LCD, pass the port instead. Each port type has an init function that sets the driver mode for it:
+- init_phi_prompt_hardware_serial() for a HardwareSerial, such as Serial1. Buffered: bytes go into the transmit buffer only as far as they fit, so the CPU doesn't wait on the wire.
+- init_phi_prompt() for a SoftwareSerial and init_phi_prompt_stream() for any other Stream. Unbuffered: each byte is sent before write() returns.
+*/
+#ifndef phi_prompt_display_h
+#define phi_prompt_display_h
+
+#if ARDUINO < 100
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+// PCF8574 backpack pin assignment. These match the common LCM1602 style backpacks. Change them if your backpack is wired differently.
+#define phi_prompt_i2c_rs B00000001         ///< PCF8574 bit connected to RS.
+#define phi_prompt_i2c_en B00000100         ///< PCF8574 bit connected to E.
+#define phi_prompt_i2c_backlight B00001000  ///< PCF8574 bit connected to the backlight transistor.
+#define phi_prompt_i2c_data_shift 4         ///< D4-D7 are connected to PCF8574 bits 4-7.
+#define phi_prompt_i2c_burst 8              ///< Characters per I2C transmission. Each character takes 4 bytes and the Wire buffer holds 32.
+
+// serLCD backpack commands
+#define phi_prompt_serlcd_special 0x7C      ///< Flag byte that makes a serLCD backpack treat the next byte as a setting, such as a baud rate code.
+#define phi_prompt_serlcd_baud_base 11      ///< Baud rate code for 2400. Codes up to 16 for 38400 follow the rates in phi_prompt_serlcd_bauds.
+
+class phi_prompt_display    ///< This is the interface phi_prompt sends all display output through.
+{
+  public:
+  virtual void command(byte cmd)=0;                     ///< Sends an HD44780 instruction such as 0x01 for clear or 0x80+address to move the cursor.
+  virtual void write(byte ch)=0;                        ///< Sends a character, or a row of a custom character after a set CGRAM address instruction.
+  virtual void write(const byte *buffer, byte size);    ///< Sends a run of characters. Drivers override this when they can send them in one burst.
+  virtual byte type()=0;                                ///< Returns HD44780_lcd or serial_lcd so the library knows what it is talking to.
+  virtual byte room();                                  ///< Returns how many characters the driver takes now without waiting, a command counting as two. Drivers that send at once return 255.
+  virtual boolean idle();                               ///< Returns true once everything handed to the driver has gone out to the display. Drivers that send at once always return true.
+};
+
+class phi_prompt_serial_lcd : public phi_prompt_display    ///< Serial LCD backpacks that take 0xFE followed by an HD44780 instruction, such as the SparkFun serLCD.
+{
+  public:
+  phi_prompt_serial_lcd(Print *p, boolean b=false);
+  virtual void command(byte cmd);
+  virtual void write(byte ch);
+  virtual void write(const byte *buffer, byte size);
+  virtual byte type();
+  virtual byte room();
+  virtual boolean idle();
+  boolean set_baud(long baud);                          ///< Switches a serLCD style backpack to another baud rate. Begin the port at the new rate once the command has gone out. Returns false for a rate the backpack doesn't have.
+  Print *port;                                          ///< This is the serial port the display is on, such as a SoftwareSerial or Serial1.
+  boolean buffered;                                     ///< Set for ports with a transmit buffer emptied by an interrupt, such as Serial1. Bytes are then only handed over as far as availableForWrite() says they fit.
+  int capacity;                                         ///< This is the most room the transmit buffer has shown, which it has when empty.
+};
+
+class phi_prompt_parallel_lcd : public phi_prompt_display  ///< HD44780 in 4-bit mode on 6 pins. RW must be tied to ground.
+{
+  public:
+  phi_prompt_parallel_lcd(byte rs, byte en, byte d4, byte d5, byte d6, byte d7);
+  void begin();                                         ///< Initializes the controller in 4-bit 2-line mode. Call it once before init_phi_prompt_driver().
+  virtual void command(byte cmd);
+  virtual void write(byte ch);
+  virtual byte type();
+  private:
+  void send(byte value, byte mode);
+  void nibble(byte value);
+  byte rs_pin, en_pin, data_pins[4];
+};
+
+class phi_prompt_i2c_lcd : public phi_prompt_display       ///< HD44780 in 4-bit mode behind a PCF8574 I2C port expander. Include Wire.h in your sketch.
+{
+  public:
+  phi_prompt_i2c_lcd(byte address);
+  void begin();                                         ///< Initializes the controller in 4-bit 2-line mode. Call Wire.begin() first.
+  void backlight(boolean on);                           ///< Turns the backlight on or off.
+  virtual void command(byte cmd);
+  virtual void write(byte ch);
+  virtual void write(const byte *buffer, byte size);
+  virtual byte type();
+  private:
+  void send(const byte *buffer, byte size, byte mode);
+  byte i2c_address, backlight_bit;
+};
+
+class phi_prompt_mirror_display : public phi_prompt_display  ///< Sends everything to two displays of the same size, so one render shows on both, such as a front panel and a remote one.
+{
+  public:
+  phi_prompt_mirror_display(phi_prompt_display *a, phi_prompt_display *b);
+  virtual void command(byte cmd);
+  virtual void write(byte ch);
+  virtual void write(const byte *buffer, byte size);
+  virtual byte type();
+  virtual byte room();
+  virtual boolean idle();
+  phi_prompt_display *first;                            ///< This is the display whose type() the library sees.
+  phi_prompt_display *second;                           ///< This is the display that shows the same. Chain another mirror here for three or more.
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+Number formatting for phi_prompt. See phi_prompt_format.h.
+*/
+
+#if ARDUINO < 100
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#include <phi_prompt_format.h>
+
+/**
+ * \details Writes the digits of value into the end of a buffer, working back from end, with a decimal point before the last decimals digits and at least one digit in front of it.
+ * \return Returns where the number starts in the buffer.
+ */
+static char *format_digits(char *end, unsigned long value, byte decimals)
+{
+  char *p=end;
+  for (byte i=0;i<decimals;i++)
+  {
+    *--p='0'+value%10;
+    value/=10;
+  }
+  if (decimals) *--p='.';
+  do
+  {
+    *--p='0'+value%10;
+    value/=10;
+  } while (value);
+  return p;
+}
+
+/**
+ * \details Formats value into exactly width characters plus the terminating 0. A value too long for the width shows as # in every character.
+ * \param dst This is where the characters go. It needs room for width characters and the terminating 0.
+ * \param value This is the number to show. With decimals it is scaled, so 1250 with 2 decimals shows as 12.50.
+ * \param width This is the number of characters to fill.
+ * \param decimals This is the number of digits after the decimal point for fixed-point values, 0 for whole numbers.
+ * \param option This is 0 to space pad right, 1 to zero pad left after any sign or 2 to space pad left.
+ */
+void phi_prompt_format_number(char *dst, long value, byte width, byte decimals, byte option)
+{
+  char digits[phi_prompt_format_digits];
+  char *end=digits+phi_prompt_format_digits;
+  if (decimals>phi_prompt_format_decimals) // They would run past digits.
+  {
+    memset(dst,'#',width);
+    dst[width]=0;
+    return;
+  }
+  char *p=format_digits(end,(value<0)?0UL-(unsigned long)value:value,decimals);
+  if (value<0) *--p='-';
+  byte len=end-p, pad=(len<width)?width-len:0;
+  if (len>width) memset(dst,'#',width);
+  else if (option==0) // Space pad right
+  {
+    memcpy(dst,p,len);
+    memset(dst+len,' ',pad);
+  }
+  else if ((option==1)&&(value<0)) // Zero pad left, after the sign
+  {
+    dst[0]='-';
+    memset(dst+1,'0',pad);
+    memcpy(dst+1+pad,p+1,len-1);
+  }
+  else // Zero or space pad left
+  {
+    memset(dst,(option==1)?'0':' ',pad);
+    memcpy(dst+pad,p,len);
+  }
+  dst[width]=0;
+}
+
+/**
+ * \details Formats a list position as current/total, such as 3/16, with the terminating 0.
+ * \param dst This is where the characters go. It needs room for both numbers, the slash and the terminating 0.
+ * \return Returns the number of characters written, not counting the terminating 0.
+ */
+byte phi_prompt_format_index(char *dst, long current, long total)
+{
+  char digits[2*phi_prompt_format_digits];
+  char *end=digits+sizeof(digits);
+  char *p=format_digits(end,(total<0)?0UL-(unsigned long)total:total,0);
+  if (total<0) *--p='-';
+  *--p='/';
+  p=format_digits(p,(current<0)?0UL-(unsigned long)current:current,0);
+  if (current<0) *--p='-';
+  byte len=end-p;
+  memcpy(dst,p,len);
+  dst[len]=0;
+  return len;
+}
@@ -0,0 +1,21 @@
+/*
+Number formatting for phi_prompt.
+These write whole numbers, fixed-point numbers and "n/m" list positions straight into a character buffer, such as the one a widget prints to the display from.
+They only divide by 10, so they don't pull vfprintf into the sketch the way sprintf does and they run several times faster on AVR.
+*/
+#ifndef phi_prompt_format_h
+#define phi_prompt_format_h
+
+#if ARDUINO < 100
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#define phi_prompt_format_digits ((int)sizeof(long)*5/2+4) ///< Longest number the formatter produces: a sign, every digit of a long (10 on AVR, so 14 in all), a leading zero and a decimal point.
+#define phi_prompt_format_decimals 10 ///< Most decimals a fixed-point value takes. More show as # like a value too long for its field.
+
+void phi_prompt_format_number(char *dst, long value, byte width, byte decimals, byte option); ///< Formats value into exactly width characters, space padded right (option 0), zero padded left (1) or space padded left (2).
+byte phi_prompt_format_index(char *dst, long current, long total);                           ///< Formats a list position such as 3/16 and returns its length.
+
+#endif